@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "FlatArray.h"
+
+// Read-only array kept in fixed-size chunks that copies share. Copying costs a
+// pointer per chunk, and replacing a chunk in one copy leaves the others alone,
+// so successive versions of a large array that differ in a few places (live
+// edge weights) share everything else. Indexing is one extra load.
+template<typename T>
+class ChunkedArray {
+public:
+    static const size_t CHUNK_BITS = 12;
+    static const size_t CHUNK = size_t(1) << CHUNK_BITS; // elements per chunk
+
+    ChunkedArray() = default;
+    ChunkedArray(std::vector<T> v): ChunkedArray(FlatArray<T>(std::move(v))) {}
+    // chunks point into a's elements and keep them alive
+    ChunkedArray(FlatArray<T> a): len(a.size()) {
+        size_t chunks = (len + CHUNK - 1) >> CHUNK_BITS;
+        ptr.resize(chunks);
+        keep.assign(chunks, a);
+        for(size_t c=0;c<chunks;c++) ptr[c] = a.data() + (c << CHUNK_BITS);
+    }
+
+    const T& operator[](size_t i) const { return ptr[i >> CHUNK_BITS][i & (CHUNK - 1)]; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+
+    // chunk c holds elements [c * CHUNK, c * CHUNK + chunkSize(c)) contiguously
+    size_t chunkCount() const { return ptr.size(); }
+    const T* chunk(size_t c) const { return ptr[c]; }
+    size_t chunkSize(size_t c) const { return std::min(CHUNK, len - (c << CHUNK_BITS)); }
+
+    // give chunk c its own copy of src[c * CHUNK ...], src indexed like this array
+    void replaceChunk(size_t c, const T *src){
+        const T *from = src + (c << CHUNK_BITS);
+        keep[c] = FlatArray<T>(std::vector<T>(from, from + chunkSize(c)));
+        ptr[c] = keep[c].data();
+    }
+
+    std::vector<T> toVector() const {
+        std::vector<T> v;
+        v.reserve(len);
+        for(size_t c=0;c<ptr.size();c++) v.insert(v.end(), ptr[c], ptr[c] + chunkSize(c));
+        return v;
+    }
+
+private:
+    std::vector<const T*> ptr;
+    std::vector<FlatArray<T>> keep; // owner of each chunk; several may share one buffer
+    size_t len{0};
+};
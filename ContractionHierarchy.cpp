@@ -0,0 +1,498 @@
+#include "ContractionHierarchy.h"
+#include "DistanceCache.h"
+#include "../utils/ThreadPool.h"
+#include <queue>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+using P = std::pair<long long,int>;
+
+struct Edge { int to; long long w; };
+
+// witness searches give up after this many settled nodes and keep the shortcut
+const int WITNESS_SETTLE_LIMIT = 100;
+
+// dense distance array reused across searches, reset through the touched list
+struct LocalDist {
+    std::vector<long long> dist;
+    std::vector<int> touched;
+    void init(int n){ dist.assign(n, Graph::INF); touched.clear(); }
+    void set(int v, long long d){
+        if(dist[v] == Graph::INF) touched.push_back(v);
+        dist[v] = d;
+    }
+    void reset(){
+        for(int v: touched) dist[v] = Graph::INF;
+        touched.clear();
+    }
+};
+
+bool byTarget(const Edge &e, int v){ return e.to < v; }
+
+struct Contractor {
+    int n;
+    std::vector<std::vector<Edge>> nbr; // remaining (uncontracted) graph, each list sorted by target
+    std::vector<char> contracted;
+    std::vector<int> deletedNeighbors;
+    std::vector<int> level; // hierarchy depth, keeps contraction spread evenly
+    LocalDist ld;
+    std::vector<P> heap; // witness search queue, reused
+    std::vector<int> targetOf; // node -> search that still needs its distance
+    int searchId{0};
+    bool witnesses;
+
+    Contractor(const Graph &g, bool witnesses_): n(g.n), nbr(g.n), contracted(g.n, 0), deletedNeighbors(g.n, 0), level(g.n, 0), witnesses(witnesses_) {
+        for(int u=0;u<n;u++){
+            g.forEachNeighbour(u, [&](int v, int w){
+                if(v != u) addOrRelax(u, v, w);
+            });
+        }
+        ld.init(n);
+        targetOf.assign(n, -1);
+    }
+
+    // keep a single edge per node pair with the smallest weight
+    bool addOrRelax(int u, int v, long long w){
+        auto &lst = nbr[u];
+        auto it = std::lower_bound(lst.begin(), lst.end(), v, byTarget);
+        if(it != lst.end() && it->to == v){
+            if(w < it->w){ it->w = w; return true; }
+            return false;
+        }
+        lst.insert(it, {v, w});
+        return true;
+    }
+
+    void removeEdge(int u, int v){
+        auto &lst = nbr[u];
+        auto it = std::lower_bound(lst.begin(), lst.end(), v, byTarget);
+        if(it != lst.end() && it->to == v) lst.erase(it);
+    }
+
+    // local Dijkstra from src in the remaining graph, skipping `via`; stops once
+    // the `targets` nodes marked with searchId are settled, their distances being final
+    void witnessSearch(int src, int via, long long maxDist, int targets){
+        auto later = std::greater<P>();
+        heap.clear();
+        ld.set(src, 0); heap.push_back({0, src});
+        int settled = 0;
+        while(!heap.empty()){
+            std::pop_heap(heap.begin(), heap.end(), later);
+            auto [d,u] = heap.back(); heap.pop_back();
+            if(d != ld.dist[u]) continue;
+            if(d > maxDist || ++settled > WITNESS_SETTLE_LIMIT) break;
+            if(targetOf[u] == searchId && --targets == 0) break;
+            for(auto &e: nbr[u]){
+                if(e.to == via) continue;
+                long long nd = d + e.w;
+                if(nd < ld.dist[e.to]){
+                    ld.set(e.to, nd);
+                    heap.push_back({nd, e.to});
+                    std::push_heap(heap.begin(), heap.end(), later);
+                }
+            }
+        }
+    }
+
+    // shortcuts (u, w, weight) needed to contract v
+    void findShortcuts(int v, std::vector<std::pair<std::pair<int,int>,long long>>& out){
+        out.clear();
+        auto &nv = nbr[v];
+        for(size_t i=0;i+1<nv.size();i++){
+            int u = nv[i].to;
+            if(witnesses){ // otherwise every pair gets a shortcut
+                // only the later neighbours are targets: earlier pairs were settled from their side
+                searchId++;
+                long long maxOut = 0;
+                for(size_t j=i+1;j<nv.size();j++){
+                    maxOut = std::max(maxOut, nv[j].w);
+                    targetOf[nv[j].to] = searchId;
+                }
+                witnessSearch(u, v, nv[i].w + maxOut, (int)(nv.size() - i - 1));
+            }
+            for(size_t j=i+1;j<nv.size();j++){
+                int w = nv[j].to;
+                long long via = nv[i].w + nv[j].w;
+                if(ld.dist[w] > via) out.push_back({{u, w}, via});
+            }
+            ld.reset();
+        }
+    }
+
+    int priority(int v, std::vector<std::pair<std::pair<int,int>,long long>>& scratch){
+        findShortcuts(v, scratch);
+        return 2*((int)scratch.size() - (int)nbr[v].size()) + deletedNeighbors[v] + level[v];
+    }
+
+    // add the shortcuts found for v, move its remaining edges into `up` and remove it;
+    // returns the number of new shortcut edges
+    size_t contract(int v, const std::vector<std::pair<std::pair<int,int>,long long>>& sc, std::vector<Edge>& up){
+        size_t added = 0;
+        for(auto &s: sc){
+            int a = s.first.first, b = s.first.second;
+            if(addOrRelax(a, b, s.second)){
+                addOrRelax(b, a, s.second);
+                added++;
+            }
+        }
+        up = nbr[v]; // every remaining neighbour ends up ranked higher
+        for(auto &e: nbr[v]){
+            removeEdge(e.to, v);
+            deletedNeighbors[e.to]++;
+            level[e.to] = std::max(level[e.to], level[v] + 1);
+        }
+        nbr[v].clear();
+        nbr[v].shrink_to_fit();
+        contracted[v] = 1;
+        return added;
+    }
+};
+
+// upward edge lists -> CSR arrays, each node's edges sorted by target
+void flatten(const std::vector<std::vector<Edge>>& up, std::vector<int>& off, std::vector<int>& tgt, std::vector<long long>& w){
+    const int n = (int)up.size();
+    off.assign(n + 1, 0);
+    for(int v=0;v<n;v++) off[v+1] = off[v] + (int)up[v].size();
+    tgt.resize(off[n]);
+    w.resize(off[n]);
+    for(int v=0;v<n;v++){
+        std::vector<Edge> sorted(up[v]);
+        std::sort(sorted.begin(), sorted.end(), [](const Edge &a, const Edge &b){ return a.to < b.to; });
+        int k = off[v];
+        for(auto &e: sorted){ tgt[k] = e.to; w[k] = e.w; k++; }
+    }
+}
+
+} // namespace
+
+ContractionHierarchy::ContractionHierarchy(int n_, size_t shortcuts_, FlatArray<int> rank_, FlatArray<int> upOffset_,
+                                           FlatArray<int> upTarget_, ChunkedArray<long long> upWeight_)
+    : n(n_), rank(std::move(rank_)), upOffset(std::move(upOffset_)), upTarget(std::move(upTarget_)),
+      upWeight(std::move(upWeight_)), shortcuts(shortcuts_) {}
+
+ContractionHierarchy::ContractionHierarchy(const Graph &g): n(g.n) {
+    Contractor c(g, true);
+    std::vector<int> rnk(n, 0);
+    std::vector<std::vector<Edge>> up(n);
+    std::vector<std::pair<std::pair<int,int>,long long>> sc;
+
+    std::priority_queue<P, std::vector<P>, std::greater<P>> pq;
+    for(int v=0;v<n;v++) pq.push({c.priority(v, sc), v});
+
+    int nextRank = 0;
+    while(!pq.empty()){
+        auto [p,v] = pq.top(); pq.pop();
+        if(c.contracted[v]) continue;
+        // lazy update: re-evaluate and requeue if no longer the minimum
+        long long cur = c.priority(v, sc);
+        if(!pq.empty() && cur > pq.top().first){
+            pq.push({cur, v});
+            continue;
+        }
+        shortcuts += c.contract(v, sc, up[v]);
+        rnk[v] = nextRank++;
+    }
+
+    std::vector<int> off, tgt;
+    std::vector<long long> w;
+    flatten(up, off, tgt, w);
+    rank = std::move(rnk);
+    upOffset = std::move(off);
+    upTarget = std::move(tgt);
+    upWeight = std::move(w);
+}
+
+ContractionHierarchy::ContractionHierarchy(const Graph &g, const std::vector<int>& order): n(g.n) {
+    Contractor c(g, false);
+    std::vector<int> rnk(n, 0);
+    std::vector<std::vector<Edge>> up(n);
+    std::vector<std::pair<std::pair<int,int>,long long>> sc;
+    for(int r=0;r<(int)order.size();r++){
+        int v = order[r];
+        c.findShortcuts(v, sc);
+        shortcuts += c.contract(v, sc, up[v]);
+        rnk[v] = r;
+    }
+
+    std::vector<int> off, tgt;
+    std::vector<long long> w;
+    flatten(up, off, tgt, w);
+    rank = std::move(rnk);
+    upOffset = std::move(off);
+    upTarget = std::move(tgt);
+    upWeight = std::move(w);
+}
+
+// Nested dissection: split the nodes by a BFS level (the separator), order both
+// halves recursively and put the separator last. Keeps fill-in, and so the
+// shortcut count of a witness-free hierarchy, close to O(n log n) on road networks.
+std::vector<int> ContractionHierarchy::dissectionOrder(const Graph &g){
+    const int LEAF = 2;
+    std::vector<int> order;
+    order.reserve(g.n);
+    std::vector<int> stamp(g.n, -1), depth(g.n, -1);
+    struct Task { std::vector<int> nodes; bool emit; };
+    std::vector<Task> stack;
+    {
+        std::vector<int> all(g.n);
+        for(int v=0;v<g.n;v++) all[v] = v;
+        stack.push_back({std::move(all), false});
+    }
+    int id = 0;
+    std::vector<int> frontier;
+    // BFS inside the current task's nodes; returns the last node reached
+    auto bfs = [&](int src, int task){
+        for(int v: frontier) depth[v] = -1;
+        frontier.clear();
+        depth[src] = 0;
+        frontier.push_back(src);
+        for(size_t h=0;h<frontier.size();h++){
+            int u = frontier[h];
+            g.forEachNeighbour(u, [&](int v, int){
+                if(stamp[v] == task && depth[v] < 0){ depth[v] = depth[u] + 1; frontier.push_back(v); }
+            });
+        }
+        return frontier.back();
+    };
+    while(!stack.empty()){
+        Task t = std::move(stack.back());
+        stack.pop_back();
+        if(t.emit || (int)t.nodes.size() <= LEAF){
+            order.insert(order.end(), t.nodes.begin(), t.nodes.end());
+            continue;
+        }
+        int task = id++;
+        for(int v: t.nodes) stamp[v] = task;
+        bfs(bfs(t.nodes[0], task), task); // second sweep from a far node gives thin levels
+        std::vector<int> reached(frontier), rest;
+        if(reached.size() < t.nodes.size()){
+            // more than one component: no separator needed between them
+            for(int v: t.nodes) if(depth[v] < 0) rest.push_back(v);
+            stack.push_back({std::move(rest), false});
+            stack.push_back({std::move(reached), false});
+            continue;
+        }
+        // separator: the smallest BFS level that leaves at least a third of the nodes on each side
+        std::vector<int> levelSize(depth[reached.back()] + 1, 0);
+        for(int v: reached) levelSize[depth[v]]++;
+        const size_t total = reached.size();
+        const int last = depth[reached.back()];
+        int mid = std::min(depth[reached[total / 2]], last - 1); // something must remain above the separator
+        size_t before = 0;
+        for(int l=0;l<last;l++){
+            if(before >= total / 3 && before + levelSize[l] <= total - total / 3 && levelSize[l] < levelSize[mid]) mid = l;
+            before += levelSize[l];
+        }
+        std::vector<int> low, sep, high;
+        for(int v: reached){
+            if(depth[v] < mid) low.push_back(v);
+            else if(depth[v] > mid) high.push_back(v);
+            else {
+                // only nodes touching the far side actually separate
+                bool touchesHigh = false;
+                g.forEachNeighbour(v, [&](int u, int){ if(stamp[u] == task && depth[u] > mid) touchesHigh = true; });
+                (touchesHigh ? sep : low).push_back(v);
+            }
+        }
+        // pushed in reverse: low, then high, then the separator are emitted
+        stack.push_back({std::move(sep), true});
+        stack.push_back({std::move(high), false});
+        stack.push_back({std::move(low), false});
+    }
+    for(int v: frontier) depth[v] = -1;
+    return order;
+}
+
+void ContractionHierarchy::upwardSearch(int src, std::vector<std::pair<int,long long>>& space) const {
+    thread_local LocalDist ld;
+    if((int)ld.dist.size() != n) ld.init(n);
+    thread_local std::vector<P> heap;
+    auto later = std::greater<P>();
+    space.clear();
+    if(src<0 || src>=n) return;
+    heap.clear();
+    ld.set(src, 0); heap.push_back({0, src});
+    while(!heap.empty()){
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto [d,u] = heap.back(); heap.pop_back();
+        if(d != ld.dist[u]) continue;
+        // stall-on-demand: u is reached shorter through a higher neighbour, so d is not its true distance
+        bool stalled = false;
+        for(int k=upOffset[u];k<upOffset[u+1] && !stalled;k++){
+            stalled = ld.dist[upTarget[k]] + upWeight[k] < d;
+        }
+        if(stalled) continue;
+        space.push_back({u, d});
+        for(int k=upOffset[u];k<upOffset[u+1];k++){
+            long long nd = d + upWeight[k];
+            int v = upTarget[k];
+            if(nd < ld.dist[v]){
+                ld.set(v, nd);
+                heap.push_back({nd, v});
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+    }
+    ld.reset();
+}
+
+const SearchSpace& ContractionHierarchy::searchFrom(int node, DistanceCache *cache, uint64_t version,
+                                                    SearchSpace &space, std::shared_ptr<const SearchSpace> &hold) const {
+    if(!cache || node < 0 || node >= n){
+        upwardSearch(node, space);
+        return space;
+    }
+    hold = cache->find(node, version);
+    if(!hold){
+        upwardSearch(node, space);
+        hold = cache->insert(node, version, space);
+    }
+    return *hold;
+}
+
+long long ContractionHierarchy::distance(int s, int t) const {
+    return manyToMany({s}, {t})[0];
+}
+
+std::vector<long long> ContractionHierarchy::manyToMany(const std::vector<int>& sources, const std::vector<int>& targets,
+                                                        DistanceCache *cache, uint64_t version, ThreadPool *pool) const {
+    const size_t T = targets.size();
+    std::vector<long long> result(sources.size() * T, Graph::INF);
+    if(result.empty()) return result;
+
+    // backward phase: (target, dist) at every node of each target's search space.
+    // The graph is undirected, so one upward search from a node serves it as source and as target
+    struct Entry { int node; int target; long long d; };
+    std::vector<std::vector<Entry>> found(ThreadPool::slices(pool, T));
+    ThreadPool::forSlices(pool, T, [&](int s, size_t begin, size_t end){
+        SearchSpace space;
+        std::shared_ptr<const SearchSpace> hold;
+        for(size_t j=begin;j<end;j++){
+            for(auto &p: searchFrom(targets[j], cache, version, space, hold)) found[s].push_back({p.first, (int)j, p.second});
+        }
+    });
+
+    // group the entries into one bucket per node (counting sort, nodes in first-seen order)
+    thread_local std::vector<int> bucketOfNode;
+    if((int)bucketOfNode.size() != n) bucketOfNode.assign(n, -1);
+    std::vector<int> &bucketOf = bucketOfNode; // the caller's, also read by the workers below
+    std::vector<int> nodes, start;
+    for(auto &f: found){
+        for(auto &e: f){
+            int &b = bucketOf[e.node];
+            if(b < 0){ b = (int)nodes.size(); nodes.push_back(e.node); start.push_back(0); }
+            start[b]++;
+        }
+    }
+    start.push_back(0);
+    int total = 0;
+    for(auto &c: start){ int k = c; c = total; total += k; }
+    struct Hit { int target; long long d; };
+    std::vector<Hit> bucket(total);
+    {
+        std::vector<int> fill(start.begin(), start.end() - 1);
+        for(auto &f: found){
+            for(auto &e: f) bucket[fill[bucketOf[e.node]]++] = {e.target, e.d};
+        }
+    }
+    found.clear();
+
+    // forward phase: scan the buckets met by each source's search space, rows split across the pool
+    ThreadPool::forSlices(pool, sources.size(), [&](int, size_t begin, size_t end){
+        SearchSpace space;
+        std::shared_ptr<const SearchSpace> hold;
+        for(size_t i=begin;i<end;i++){
+            long long *row = &result[i * T];
+            for(auto &s: searchFrom(sources[i], cache, version, space, hold)){
+                int b = bucketOf[s.first];
+                if(b < 0) continue;
+                for(int k=start[b];k<start[b+1];k++){
+                    long long d = s.second + bucket[k].d;
+                    if(d < row[bucket[k].target]) row[bucket[k].target] = d;
+                }
+            }
+        }
+    });
+
+    for(int v: nodes) bucketOf[v] = -1;
+    return result;
+}
+
+std::vector<long long> ContractionHierarchy::pairDistances(const std::vector<std::pair<int,int>>& pairs,
+                                                           DistanceCache *cache, uint64_t version, ThreadPool *pool) const {
+    std::vector<long long> result(pairs.size(), Graph::INF);
+    if(pairs.empty()) return result;
+
+    // distances are symmetric: keep the side with fewer distinct nodes as the one whose
+    // searches are held, and walk the other side one node at a time
+    thread_local std::vector<int> heldIndexOfNode;
+    if((int)heldIndexOfNode.size() != n) heldIndexOfNode.assign(n, -1);
+    std::vector<int> &heldIndex = heldIndexOfNode; // the caller's, also read by the workers below
+    std::vector<int> held;
+    auto distinct = [&](bool second){
+        size_t count = 0;
+        for(auto &p: pairs){
+            int v = second ? p.second : p.first;
+            if(v >= 0 && v < n && heldIndex[v] < 0){ heldIndex[v] = 0; count++; }
+        }
+        for(auto &p: pairs){
+            int v = second ? p.second : p.first;
+            if(v >= 0 && v < n) heldIndex[v] = -1;
+        }
+        return count;
+    };
+    const bool swap = distinct(false) < distinct(true);
+    auto walk = [&](size_t k){ return swap ? pairs[k].second : pairs[k].first; };
+    auto hold = [&](size_t k){ return swap ? pairs[k].first : pairs[k].second; };
+
+    for(size_t k=0;k<pairs.size();k++){
+        int v = hold(k);
+        if(v >= 0 && v < n && heldIndex[v] < 0){ heldIndex[v] = (int)held.size(); held.push_back(v); }
+    }
+    std::vector<std::shared_ptr<const SearchSpace>> spaces(held.size());
+    ThreadPool::forSlices(pool, held.size(), [&](int, size_t begin, size_t end){
+        SearchSpace space;
+        std::shared_ptr<const SearchSpace> keep;
+        for(size_t h=begin;h<end;h++){
+            keep.reset();
+            const SearchSpace &s = searchFrom(held[h], cache, version, space, keep);
+            spaces[h] = keep ? keep : std::make_shared<const SearchSpace>(s);
+        }
+    });
+
+    // pairs grouped by their walked node: one search and one marking per group
+    std::vector<int> order(pairs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b){ return walk(a) < walk(b); });
+    std::vector<size_t> groups;
+    for(size_t k=0;k<order.size();k++) if(k == 0 || walk(order[k]) != walk(order[k-1])) groups.push_back(k);
+    groups.push_back(order.size());
+
+    ThreadPool::forSlices(pool, groups.size() - 1, [&](int, size_t begin, size_t end){
+        thread_local LocalDist mark;
+        if((int)mark.dist.size() != n) mark.init(n);
+        SearchSpace space;
+        std::shared_ptr<const SearchSpace> keep;
+        for(size_t g=begin;g<end;g++){
+            int v = walk(order[groups[g]]);
+            if(v < 0 || v >= n) continue;
+            for(auto &s: searchFrom(v, cache, version, space, keep)) mark.set(s.first, s.second);
+            for(size_t k=groups[g];k<groups[g+1];k++){
+                int h = hold(order[k]);
+                if(h < 0 || h >= n) continue;
+                long long best = Graph::INF;
+                for(auto &s: *spaces[heldIndex[h]]){
+                    long long d = mark.dist[s.first];
+                    if(d != Graph::INF) best = std::min(best, d + s.second);
+                }
+                result[order[k]] = best;
+            }
+            mark.reset();
+        }
+    });
+    for(int v: held) heldIndex[v] = -1;
+    return result;
+}
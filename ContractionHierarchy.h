@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <utility>
+#include "Graph.h"
+#include "../utils/FlatArray.h"
+#include "../utils/ChunkedArray.h"
+
+class DistanceCache;
+class ThreadPool;
+
+// Contraction hierarchy over an undirected Graph.
+// Nodes are contracted in edge-difference order; only upward edges
+// (lower rank -> higher rank, shortcuts included) are kept, so the
+// forward and backward halves of a query share one search graph.
+class ContractionHierarchy {
+public:
+    explicit ContractionHierarchy(const Graph &g);
+
+    // contract in a fixed order without witness searches, keeping a shortcut for every
+    // pair of neighbours. Upward weights then follow from lower triangles alone, so they
+    // can be recomputed exactly for new edge weights (see LiveGraph)
+    ContractionHierarchy(const Graph &g, const std::vector<int>& order);
+
+    // fill-reducing node order for the constructor above
+    static std::vector<int> dissectionOrder(const Graph &g);
+
+    // adopt a hierarchy built earlier (e.g. mapped from a GraphFile)
+    ContractionHierarchy(int n_, size_t shortcuts_, FlatArray<int> rank_, FlatArray<int> upOffset_,
+                         FlatArray<int> upTarget_, ChunkedArray<long long> upWeight_);
+
+    int nodeCount() const { return n; }
+    size_t shortcutCount() const { return shortcuts; }
+
+    // shortest distance between two nodes (Graph::INF if unreachable)
+    long long distance(int s, int t) const;
+
+    // bucket-based many-to-many query, result is row-major sources x targets.
+    // With a cache, upward searches are looked up under (node, version) first and stored after.
+    // With a pool, the target searches and then the source rows are split across its workers,
+    // all of them scanning the one set of buckets
+    std::vector<long long> manyToMany(const std::vector<int>& sources, const std::vector<int>& targets,
+                                      DistanceCache *cache = nullptr, uint64_t version = 0, ThreadPool *pool = nullptr) const;
+
+    // distance of each (s, t) pair: one upward search per distinct node and one scan per
+    // pair, for callers that need a few entries of a large table
+    std::vector<long long> pairDistances(const std::vector<std::pair<int,int>>& pairs,
+                                         DistanceCache *cache = nullptr, uint64_t version = 0, ThreadPool *pool = nullptr) const;
+
+    // raw arrays, for serialization
+    const FlatArray<int>& ranks() const { return rank; }
+    const FlatArray<int>& upOffsets() const { return upOffset; }
+    const FlatArray<int>& upTargets() const { return upTarget; }
+    const ChunkedArray<long long>& upWeights() const { return upWeight; }
+
+private:
+    int n;
+    FlatArray<int> rank;
+    // upward search graph in CSR form
+    FlatArray<int> upOffset;
+    FlatArray<int> upTarget;
+    ChunkedArray<long long> upWeight; // chunked: LiveGraph versions share unchanged chunks
+    size_t shortcuts{0};
+
+    // settled (node, dist) pairs of the upward search from src
+    void upwardSearch(int src, std::vector<std::pair<int,long long>>& space) const;
+    // upwardSearch through the cache: the result is space, or a cached copy kept alive by hold
+    const std::vector<std::pair<int,long long>>& searchFrom(int node, DistanceCache *cache, uint64_t version,
+                                                            std::vector<std::pair<int,long long>>& space,
+                                                            std::shared_ptr<const std::vector<std::pair<int,long long>>>& hold) const;
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, reflected, poly 0xEDB88320), table driven.
+inline uint32_t crc32(const void *data, size_t len, uint32_t crc = 0){
+    static const auto table = []{
+        struct T { uint32_t v[256]; } t{};
+        for(uint32_t i=0;i<256;i++){
+            uint32_t c = i;
+            for(int k=0;k<8;k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t.v[i] = c;
+        }
+        return t;
+    }();
+    const unsigned char *p = (const unsigned char*)data;
+    crc = ~crc;
+    for(size_t i=0;i<len;i++) crc = table.v[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "../utils/FlatArray.h"
+#include "../utils/ChunkedArray.h"
+
+struct Graph;
+
+// Frozen compressed-sparse-row copy of a Graph: the neighbours of u are
+// targets[offsets[u] .. offsets[u+1]) with matching weights. The arrays are
+// either built from the adjacency lists or borrowed from a mapped GraphFile.
+// Weights are chunked so LiveGraph versions share the chunks an update missed.
+struct CsrGraph {
+    int n;
+    FlatArray<int> offsets;
+    FlatArray<int> targets;
+    ChunkedArray<int> weights;
+
+    explicit CsrGraph(const Graph &g);
+    CsrGraph(int n_, FlatArray<int> off, FlatArray<int> tgt, ChunkedArray<int> w)
+        : n(n_), offsets(std::move(off)), targets(std::move(tgt)), weights(std::move(w)) {}
+
+    int edgeCount() const { return offsets[n]; }
+};
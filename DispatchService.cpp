@@ -0,0 +1,119 @@
+#include "DispatchService.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+
+static DispatchServiceConfig sanitize(DispatchServiceConfig cfg){
+    cfg.minWindow = std::max(cfg.minWindow, std::chrono::milliseconds(1));
+    cfg.maxWindow = std::clamp(cfg.maxWindow, cfg.minWindow, std::max(cfg.minWindow, cfg.maxWait));
+    cfg.targetBatch = std::max(1, cfg.targetBatch);
+    return cfg;
+}
+
+DispatchService::DispatchService(Dispatcher &d, const Graph &g, DispatchServiceConfig c)
+    : dispatcher(d), graph(&g), cfg(sanitize(c)) {}
+
+DispatchService::DispatchService(Dispatcher &d, const LiveGraph &g, DispatchServiceConfig c)
+    : dispatcher(d), live(&g), cfg(sanitize(c)) {}
+
+DispatchService::~DispatchService(){ stop(); }
+
+void DispatchService::start(){
+    std::lock_guard<std::mutex> lg(mtx);
+    if(running) return;
+    running = true;
+    worker = std::thread(&DispatchService::loop, this);
+    LOG_INFO("Dispatch service started: window {}-{} ms, max wait {} ms", (long long)cfg.minWindow.count(),
+             (long long)cfg.maxWindow.count(), (long long)cfg.maxWait.count());
+}
+
+void DispatchService::stop(){
+    {
+        std::lock_guard<std::mutex> lg(mtx);
+        if(!running) return;
+        running = false;
+    }
+    cv.notify_all();
+    if(worker.joinable()) worker.join();
+    LOG_INFO("Dispatch service stopped after {} rounds", roundCount.load());
+}
+
+std::chrono::milliseconds DispatchService::windowCeiling() const {
+    auto c = std::chrono::milliseconds((long long)(cfg.maxWindow.count() * ceilingScale.load()));
+    return std::max(cfg.minWindow, c);
+}
+
+// linear in the backlog between minWindow and the (SLO-tuned) ceiling
+std::chrono::milliseconds DispatchService::windowFor(int backlog) const {
+    auto ceiling = windowCeiling();
+    double fill = std::min(1.0, (double)backlog / cfg.targetBatch);
+    return cfg.minWindow + std::chrono::milliseconds((long long)((ceiling - cfg.minWindow).count() * fill));
+}
+
+bool DispatchService::sleepFor(std::chrono::steady_clock::duration d){
+    std::unique_lock<std::mutex> lk(mtx);
+    return !cv.wait_for(lk, d, [this]{ return !running; });
+}
+
+void DispatchService::loop(){
+    using clock = std::chrono::steady_clock;
+    // orders may have been queued before the service started: the first round runs at once
+    auto lastRound = clock::now() - cfg.maxWindow;
+    uint64_t seenArrivals = dispatcher.arrivalCount();
+    int remaining = 1;
+    auto oldest = std::chrono::system_clock::time_point::max();
+    double roundMs = 0;     // moving average of round duration, subtracted from the maxWait deadline
+    double waitEwma = -1;   // moving average of mean time-to-assignment
+    bool stalled = false;   // last round assigned nothing: its orders have no driver right now
+
+    while(true){
+        int backlog = remaining + (int)(dispatcher.arrivalCount() - seenArrivals);
+        if(backlog == 0){
+            // idle: poll for arrivals at the shortest window
+            if(!sleepFor(cfg.minWindow)) break;
+            lastRound = clock::now();
+            continue;
+        }
+
+        auto window = windowFor(backlog);
+        auto due = lastRound + window;
+        if(oldest != std::chrono::system_clock::time_point::max()){
+            // carried-over orders must not exceed maxWait, whatever the window says
+            auto left = oldest + cfg.maxWait - std::chrono::system_clock::now();
+            auto byDeadline = clock::now() + std::chrono::duration_cast<clock::duration>(left)
+                            - std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(roundMs));
+            due = std::min(due, byDeadline);
+        }
+        // an overdue order nobody can take keeps the deadline in the past; without
+        // this floor the loop would rerun fruitless rounds back to back
+        if(stalled) due = std::max(due, lastRound + cfg.minWindow);
+        auto now = clock::now();
+        if(now < due){
+            // re-check at minWindow steps so a growing backlog can stretch the window
+            if(!sleepFor(std::min<clock::duration>(due - now, cfg.minWindow))) break;
+            continue;
+        }
+
+        if(!sleepFor(clock::duration::zero())) break; // stop() is honoured on every pass
+        lastWindowMs.store(std::chrono::duration_cast<std::chrono::milliseconds>(now - lastRound).count());
+        seenArrivals = dispatcher.arrivalCount(); // read before the round drains the inbox
+        auto t0 = clock::now();
+        DispatchRound r = live ? dispatcher.runDispatch(*live) : dispatcher.runDispatch(*graph);
+        lastRound = clock::now();
+        roundCount++;
+        double took = std::chrono::duration<double, std::milli>(lastRound - t0).count();
+        roundMs = roundMs == 0 ? took : 0.8 * roundMs + 0.2 * took;
+        remaining = r.remaining;
+        stalled = r.assigned == 0;
+        oldest = r.remaining ? r.oldest : std::chrono::system_clock::time_point::max();
+
+        // SLO tuning: shrink the ceiling on overshoot, grow it back while comfortably under
+        if(r.assigned > 0){
+            waitEwma = waitEwma < 0 ? r.meanWaitMs : 0.8 * waitEwma + 0.2 * r.meanWaitMs;
+            double target = (double)cfg.targetLatency.count(), scale = ceilingScale.load();
+            if(waitEwma > target) scale = std::max(0.05, scale * 0.8);
+            else if(waitEwma < 0.5 * target) scale = std::min(1.0, scale * 1.1);
+            ceilingScale.store(scale);
+        }
+        LOG_DEBUG("Dispatch round: {} assigned, {} remaining, window {} ms", r.assigned, r.remaining, lastWindowMs.load());
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "core/Dispatcher.h"
+#include "core/Graph.h"
+#include "core/LiveGraph.h"
+
+struct DispatchServiceConfig {
+    std::chrono::milliseconds minWindow{10};      // batch window when the queue is nearly empty
+    std::chrono::milliseconds maxWindow{500};     // batch window at targetBatch queued orders or more
+    std::chrono::milliseconds maxWait{2000};      // no queued order waits longer than this for a round
+    std::chrono::milliseconds targetLatency{1000}; // SLO on mean creation -> assignment time
+    int targetBatch = 64;
+};
+
+// Runs Dispatcher rounds on its own thread. Orders accumulate for a window
+// that grows with the backlog (small queue: short window and low latency;
+// large queue: longer window and bigger batches for the matcher). A round
+// starts early when the oldest queued order would otherwise exceed maxWait.
+// When observed time-to-assignment overshoots the SLO the window ceiling
+// shrinks, and it recovers while latency stays well under it.
+class DispatchService {
+public:
+    DispatchService(Dispatcher &d, const Graph &g, DispatchServiceConfig cfg = DispatchServiceConfig{});
+    // every round runs on the newest published weights
+    DispatchService(Dispatcher &d, const LiveGraph &g, DispatchServiceConfig cfg = DispatchServiceConfig{});
+    ~DispatchService(); // stops the thread
+
+    void start();
+    void stop();
+
+    // current ceiling / last window used, for monitoring
+    std::chrono::milliseconds windowCeiling() const;
+    std::chrono::milliseconds lastWindow() const { return std::chrono::milliseconds(lastWindowMs.load()); }
+    uint64_t rounds() const { return roundCount.load(); }
+
+private:
+    Dispatcher &dispatcher;
+    const Graph *graph{nullptr};
+    const LiveGraph *live{nullptr};
+    DispatchServiceConfig cfg;
+
+    std::thread worker;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool running{false};
+
+    std::atomic<double> ceilingScale{1.0}; // fraction of maxWindow allowed, tuned by the SLO
+    std::atomic<long long> lastWindowMs{0};
+    std::atomic<uint64_t> roundCount{0};
+
+    void loop();
+    std::chrono::milliseconds windowFor(int backlog) const;
+    bool sleepFor(std::chrono::steady_clock::duration d); // false once stopping
+};
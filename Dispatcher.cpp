@@ -1,11 +1,28 @@
 #include "core/Dispatcher.h"
 #include "../utils/Logger.h"
+#include "../utils/Metrics.h"
 
-void Dispatcher::registerDriver(std::shared_ptr<Driver> drv){
+Dispatcher::~Dispatcher(){
     std::lock_guard<std::mutex> lg(mtx);
-    drivers[drv->id] = drv;
-    drv->start();
-    Logger::info("Registered Driver " + std::to_string(drv->id));
+    for(auto &p: drivers){
+        p.second->stop();
+        p.second->setListener(nullptr);
+    }
+}
+
+void Dispatcher::registerDriver(std::shared_ptr<Driver> drv, bool startWorker){
+    std::lock_guard<std::mutex> lg(mtx);
+    drv->setListener(this);
+    if(drivers.emplace(drv->id, drv).second) Metrics::addGauge(Gauge::DRIVERS_REGISTERED, 1);
+    else drivers[drv->id] = drv;
+    if(auto idx = std::atomic_load(&index)) idx->update(drv->id, drv->location.load());
+    surge.driverAt(drv->id, drv->location.load());
+    if(auto t = std::atomic_load(&trace)) t->driverRegistered(*drv);
+    if(auto f = std::atomic_load(&feed)) f->track(drv);
+    if(auto w = std::atomic_load(&stealer)) w->track(drv);
+    if(auto r = std::atomic_load(&repositioner)) r->track(drv);
+    if(startWorker) drv->start();
+    LOG_INFO("Registered Driver {}", drv->id);
 }
 
 void Dispatcher::unregisterDriver(int id){
@@ -13,94 +30,317 @@ void Dispatcher::unregisterDriver(int id){
     auto it = drivers.find(id);
     if(it!=drivers.end()){
         it->second->stop();
+        it->second->setListener(nullptr);
         drivers.erase(it);
-        Logger::info("Unregistered Driver " + std::to_string(id));
+        Metrics::addGauge(Gauge::DRIVERS_REGISTERED, -1);
+        if(auto idx = std::atomic_load(&index)) idx->remove(id);
+        surge.driverRemoved(id);
+        if(auto t = std::atomic_load(&trace)) t->driverUnregistered(id);
+        if(auto f = std::atomic_load(&feed)) f->untrack(id);
+        if(auto w = std::atomic_load(&stealer)) w->untrack(id);
+        if(auto r = std::atomic_load(&repositioner)) r->untrack(id);
+        LOG_INFO("Unregistered Driver {}", id);
     }
 }
 
 void Dispatcher::submitOrder(const Order &o){
-    std::lock_guard<std::mutex> lg(mtx);
-    queueOrders.push_back(o);
-    Logger::info("Order queued " + std::to_string(o.id));
-    computeSurgeAndNotify();
+    InboxEvent e{InboxEvent::SUBMIT};
+    e.order = OrderPool::instance().acquire(o); // the only copy; handed along from here on
+    if(!e.order){
+        Metrics::inc(Counter::ORDERS_REJECTED); // acquire() logged it
+        return;
+    }
+    e.orderId = o.id;
+    inbox.push(std::move(e));
+    arrivals.fetch_add(1, std::memory_order_relaxed);
+    Metrics::inc(Counter::ORDERS_SUBMITTED);
+    if(auto r = std::atomic_load(&repositioner)) r->orderSubmitted(o.pickup);
+    if(auto t = std::atomic_load(&trace)) t->orderSubmitted(o);
 }
 
 void Dispatcher::cancelOrder(int orderId){
-    std::lock_guard<std::mutex> lg(mtx);
-    for(auto it = queueOrders.begin(); it != queueOrders.end(); ++it){
-        if(it->id == orderId){
-            it->status = OrderStatus::CANCELLED;
-            Logger::info("Passenger cancelled Order " + std::to_string(orderId));
-            queueOrders.erase(it);
-            computeSurgeAndNotify();
-            return;
-        }
-    }
-    Logger::info("Order " + std::to_string(orderId) + " not found in queue for cancellation.");
+    InboxEvent e{InboxEvent::CANCEL};
+    e.orderId = orderId;
+    inbox.push(std::move(e));
+    if(auto t = std::atomic_load(&trace)) t->orderCancelled(orderId);
 }
 
-void Dispatcher::notifyOrderCancelled(int orderId, int driverId){
-    std::lock_guard<std::mutex> lg(mtx);
-    Logger::info("Dispatcher received cancellation for Order " + std::to_string(orderId) + " from Driver " + std::to_string(driverId));
-    // requeue the order (set status to queued)
-    // In a full system we'd retrieve order details from DB; here we recreate minimal Order with same id and default nodes (demo)
-    Order o(orderId, 0, 0, 10.0);
-    o.status = OrderStatus::QUEUED;
-    queueOrders.push_back(o);
-    computeSurgeAndNotify();
+void Dispatcher::notifyOrderCancelled(int orderId, int driverId, PooledOrder order){
+    InboxEvent e{InboxEvent::DRIVER_CANCELLED};
+    e.orderId = orderId;
+    e.driverId = driverId;
+    e.order = std::move(order);
+    inbox.push(std::move(e));
+    arrivals.fetch_add(1, std::memory_order_relaxed); // requeued on the next round
 }
 
 void Dispatcher::notifyOrderCompleted(int orderId, int driverId, int rating){
-    std::lock_guard<std::mutex> lg(mtx);
-    Logger::info("Order " + std::to_string(orderId) + " completed by Driver " + std::to_string(driverId) + ". Rating=" + std::to_string(rating));
-    // update driver rating
-    auto it = drivers.find(driverId);
-    if(it!=drivers.end()){
-        it->second->addRating(rating);
+    InboxEvent e{InboxEvent::COMPLETED};
+    e.orderId = orderId;
+    e.driverId = driverId;
+    e.rating = rating;
+    inbox.push(std::move(e));
+}
+
+void Dispatcher::notifyOrderPickedUp(int orderId, int driverId){
+    InboxEvent e{InboxEvent::PICKED_UP};
+    e.orderId = orderId;
+    e.driverId = driverId;
+    inbox.push(std::move(e));
+}
+
+int Dispatcher::drainInbox(){
+    int cancelled = 0;
+    while(auto e = inbox.pop()){
+        switch(e->kind){
+        case InboxEvent::SUBMIT: {
+            OrderHandle h = queueOrders.insert(std::move(e->order));
+            if(h.valid()){
+                const Order &o = *queueOrders.get(h);
+                LOG_INFO("Order queued {}", e->orderId);
+                store->put(o);
+                surge.orderQueued(e->orderId, o.pickup);
+            }
+            else LOG_INFO("Order {} already queued, duplicate ignored.", e->orderId);
+            break;
+        }
+        case InboxEvent::CANCEL: {
+            if(Order *o = queueOrders.find(e->orderId)){
+                o->status = OrderStatus::CANCELLED;
+                LOG_INFO("Passenger cancelled Order {}", e->orderId);
+                queueOrders.erase(e->orderId);
+                store->transition(e->orderId, OrderStatus::CANCELLED);
+                surge.orderRemoved(e->orderId);
+                Metrics::inc(Counter::ORDERS_CANCELLED);
+                cancelled++;
+            } else {
+                LOG_INFO("Order {} not found in queue for cancellation.", e->orderId);
+            }
+            break;
+        }
+        case InboxEvent::DRIVER_CANCELLED: {
+            LOG_INFO("Dispatcher received cancellation for Order {} from Driver {}", e->orderId, e->driverId);
+            if(!e->order){
+                // the driver no longer held it (dropped before it arrived): rebuild from the journal
+                auto stored = store->get(e->orderId);
+                if(!stored){
+                    LOG_WARN("Order {} is not in the order store, cannot requeue", e->orderId);
+                    break;
+                }
+                e->order = OrderPool::instance().acquire(*stored);
+                if(!e->order) break;
+            }
+            e->order->status = OrderStatus::QUEUED;
+            store->transition(e->orderId, OrderStatus::QUEUED);
+            int pickup = e->order->pickup;
+            if(queueOrders.insert(std::move(e->order)).valid()) surge.orderQueued(e->orderId, pickup);
+            break;
+        }
+        case InboxEvent::STOLEN:
+            // the order was already handed over; only the record of who serves it changes
+            store->transition(e->orderId, OrderStatus::ASSIGNED, e->driverId);
+            break;
+        case InboxEvent::PICKED_UP:
+            store->transition(e->orderId, OrderStatus::IN_PROGRESS, e->driverId);
+            break;
+        case InboxEvent::COMPLETED: {
+            LOG_INFO("Order {} completed by Driver {}. Rating={}", e->orderId, e->driverId, e->rating);
+            store->transition(e->orderId, OrderStatus::COMPLETED, e->driverId);
+            // update driver rating
+            auto it = drivers.find(e->driverId);
+            if(it!=drivers.end()){
+                it->second->addRating(e->rating);
+            }
+            break;
+        }
+        }
     }
-    computeSurgeAndNotify();
+    return cancelled;
+}
+
+void Dispatcher::notifyDriverMoved(int driverId, int node){
+    // no dispatcher lock: the index synchronizes itself, so moves never wait on a dispatch round
+    if(auto idx = std::atomic_load(&index)) idx->update(driverId, node);
+    surge.driverAt(driverId, node);
+    if(auto t = std::atomic_load(&trace)) t->driverMoved(driverId, node);
+}
+
+PooledOrder Dispatcher::findWork(Driver &idle){
+    // no dispatcher lock: runs on the idle driver's thread, like notifyDriverMoved
+    auto w = std::atomic_load(&stealer);
+    if(!w) return PooledOrder();
+    auto idx = std::atomic_load(&index);
+    auto got = w->steal(idle, idx.get());
+    if(!got) return PooledOrder();
+    LOG_INFO("Driver {} took Order {} from Driver {}", idle.id, got->order->id, got->fromDriver);
+    InboxEvent e{InboxEvent::STOLEN};
+    e.orderId = got->order->id;
+    e.driverId = idle.id;
+    inbox.push(std::move(e));
+    Metrics::inc(Counter::ORDERS_STOLEN);
+    return std::move(got->order);
 }
 
 void Dispatcher::setStrategy(std::shared_ptr<AssignmentStrategy> strat){
     std::lock_guard<std::mutex> lg(mtx);
     strategy = strat;
-    Logger::info("Strategy updated.");
+    LOG_INFO("Strategy updated.");
 }
 
 void Dispatcher::addObserver(std::shared_ptr<SurgeObserver> obs){
+    surge.addObserver(std::move(obs));
+}
+
+void Dispatcher::enableSpatialIndex(const Graph &g, int cellSize){
+    auto idx = std::make_shared<DriverIndex>(g, cellSize);
+    std::lock_guard<std::mutex> lg(mtx);
+    for(auto &p: drivers) idx->update(p.first, p.second->location.load());
+    std::atomic_store(&index, idx);
+    LOG_INFO("Spatial index enabled: {} cells", idx->partition().cellCount());
+}
+
+void Dispatcher::enableLocationFeed(const Graph &g){
+    auto f = std::make_shared<LocationFeed>(g);
+    std::lock_guard<std::mutex> lg(mtx);
+    std::vector<std::shared_ptr<Driver>> fleet;
+    for(auto &p: drivers) fleet.push_back(p.second);
+    f->track(fleet);
+    std::atomic_store(&feed, f);
+    LOG_INFO("Location feed enabled for {} drivers", fleet.size());
+}
+
+void Dispatcher::ingestPings(const GpsPing *pings, size_t n){
+    if(auto f = std::atomic_load(&feed)) f->ingest(pings, n);
+    else droppedPings.fetch_add(n, std::memory_order_relaxed);
+}
+
+LocationFeedStats Dispatcher::locationStats() const {
+    LocationFeedStats s;
+    if(auto f = std::atomic_load(&feed)) s = f->stats();
+    s.pings += droppedPings.load(std::memory_order_relaxed);
+    s.unknown += droppedPings.load(std::memory_order_relaxed);
+    return s;
+}
+
+void Dispatcher::enableWorkStealing(const Graph &g, StealPolicy policy){
+    installStealer(std::make_shared<WorkStealer>(g, policy));
+}
+
+void Dispatcher::enableWorkStealing(const LiveGraph &g, StealPolicy policy){
+    installStealer(std::make_shared<WorkStealer>(g, policy));
+}
+
+void Dispatcher::installStealer(std::shared_ptr<WorkStealer> w){
     std::lock_guard<std::mutex> lg(mtx);
-    observers.push_back(obs);
+    std::vector<std::shared_ptr<Driver>> fleet;
+    for(auto &p: drivers) fleet.push_back(p.second);
+    w->track(fleet);
+    std::atomic_store(&stealer, w);
+    LOG_INFO("Work stealing enabled: pickups within {}", w->policy().maxDistance);
 }
 
-// compute simple surge: multiplier = 1 + max(0, (queued - available)/available * 0.1)
-void Dispatcher::computeSurgeAndNotify(){
-    int queued = (int)queueOrders.size();
-    int available = (int)drivers.size();
-    double mult = 1.0;
-    if(available>0 && queued>available){
-        mult = 1.0 + (double)(queued - available)/available * 0.1;
+void Dispatcher::enableRepositioning(const Graph &g, RepositionConfig cfg){
+    installRepositioner(std::make_shared<Repositioner>(g, cfg));
+}
+
+void Dispatcher::enableRepositioning(const LiveGraph &g, RepositionConfig cfg){
+    installRepositioner(std::make_shared<Repositioner>(g, cfg));
+}
+
+void Dispatcher::installRepositioner(std::shared_ptr<Repositioner> r){
+    std::lock_guard<std::mutex> lg(mtx);
+    std::vector<std::shared_ptr<Driver>> fleet;
+    for(auto &p: drivers) fleet.push_back(p.second);
+    r->track(fleet);
+    std::atomic_store(&repositioner, r);
+    LOG_INFO("Repositioning enabled: {} zones, every {} ms", r->zoneCount(), r->tickInterval().count());
+}
+
+void Dispatcher::recordTrace(std::shared_ptr<TraceRecorder> rec){
+    std::lock_guard<std::mutex> lg(mtx);
+    // install first: an order submitted meanwhile is then recorded twice at worst (replay drops duplicates)
+    std::atomic_store(&trace, rec);
+    drainInbox();
+    if(rec){
+        // the trace starts from the current fleet and queue so a replay begins where this run is
+        for(auto &p: drivers) rec->driverRegistered(*p.second);
+        queueOrders.forEach([&](const Order &o){ rec->orderSubmitted(o); });
     }
-    if(std::abs(mult - lastSurge) > 1e-6){
-        lastSurge = mult;
-        for(auto &o: observers){
-            if(o) o->onSurgeUpdate(mult);
+    LOG_INFO("Trace recording {}", rec ? "started" : "stopped");
+}
+
+void Dispatcher::enableJournal(const std::string &dir){
+    OrderStore::Options opts;
+    opts.dir = dir;
+    auto next = std::make_unique<OrderStore>(opts);
+    // orders that were queued or in flight when the previous process stopped; their drivers are gone
+    std::vector<Order> recovered = next->live();
+    std::lock_guard<std::mutex> lg(mtx);
+    drainInbox();
+    // orders taken before the journal was enabled keep their state: queued ones are
+    // already in the book and assigned ones are with running drivers
+    for(auto &o: store->live()) next->put(o);
+    int requeued = 0;
+    for(Order o: recovered){
+        if(store->get(o.id)) continue; // this run owns it
+        if(o.status != OrderStatus::QUEUED) next->transition(o.id, OrderStatus::QUEUED);
+        o.status = OrderStatus::QUEUED;
+        if(queueOrders.insert(o).valid()){
+            surge.orderQueued(o.id, o.pickup);
+            requeued++;
         }
-        Logger::info("Surge updated: x" + std::to_string(mult));
     }
+    store = std::move(next);
+    LOG_INFO("Order journal enabled in {}: {} orders requeued", dir, requeued);
+}
+
+void Dispatcher::enableZonalSurge(const Graph &g, int zoneSize){
+    surge.setZones(g, zoneSize);
+    LOG_INFO("Zonal surge enabled: zones of ~{} nodes", zoneSize);
 }
 
-void Dispatcher::runDispatch(const Graph &g){
+DispatchRound Dispatcher::runDispatch(const Graph &g){
     std::lock_guard<std::mutex> lg(mtx);
-    if(!strategy) return;
-    if(queueOrders.empty() || drivers.empty()) return;
+    METRICS_TIMER(Histogram::DISPATCH_LOCK_HOLD_NS); // declared after lg, so it stops just before unlock
+    Metrics::inc(Counter::DISPATCH_ROUNDS);
+    DispatchRound round;
+    round.cancelled = drainInbox();
+    // positions reported since the last round, before candidates are scored against them
+    if(auto f = std::atomic_load(&feed)) f->apply();
+    Metrics::setGauge(Gauge::ORDERS_QUEUED, (long long)queueOrders.size());
+    auto summarize = [&]{
+        round.remaining = (int)queueOrders.size();
+        round.oldest = std::chrono::system_clock::time_point::max();
+        queueOrders.forEach([&](const Order &o){ round.oldest = std::min(round.oldest, o.created); });
+        return round;
+    };
+    if(!strategy) return summarize();
+    if(queueOrders.empty() || drivers.empty()) return summarize();
     // snapshot drivers into vector (preserve order for indexing)
     std::vector<std::shared_ptr<Driver>> drvVec;
     std::vector<int> drvIds;
+    DispatchContext ctx;
+    auto idx = std::atomic_load(&index);
+    ctx.index = idx.get();
     for(auto &p: drivers){
+        if(idx) ctx.driverSlot[p.first] = (int)drvVec.size();
         drvVec.push_back(p.second);
         drvIds.push_back(p.first);
     }
-    auto assigns = strategy->assign(queueOrders, drvVec, g);
+    roundTable.build(drvVec);
+    ctx.table = &roundTable;
+    std::unordered_map<int,RoutePlan> routes;
+    ctx.routes = &routes;
+    auto batch = queueOrders.snapshot();
+    std::vector<std::pair<int,int>> assigns;
+    {
+        METRICS_TIMER(Histogram::ASSIGN_NS);
+        assigns = strategy->assign(batch, drvVec, g, ctx);
+    }
+    auto stale = installRoutes(routes, assigns, drvVec);
+    int done = 0;
+    double waitMs = 0;
+    auto now = std::chrono::system_clock::now();
     // perform assignments (map driver index to id)
     for(auto &pr: assigns){
         int orderId = pr.first;
@@ -109,16 +349,25 @@ void Dispatcher::runDispatch(const Graph &g){
         int driverId = drvIds[driverIdx];
         auto it = drivers.find(driverId);
         if(it==drivers.end()) continue;
-        // find order by id
-        for(auto it2 = queueOrders.begin(); it2 != queueOrders.end(); ++it2){
-            if(it2->id == orderId){
-                it->second->assignOrder(*it2);
-                it2->status = OrderStatus::ASSIGNED;
-                Logger::info("Assigned Order " + std::to_string(orderId) + " -> Driver " + std::to_string(driverId));
-                queueOrders.erase(it2);
-                break;
-            }
-        }
+        if(stale.count(driverIdx)) continue;
+        Order *o = queueOrders.find(orderId);
+        if(!o) continue;
+        o->status = OrderStatus::ASSIGNED;
+        LOG_INFO("Assigned Order {} -> Driver {}", orderId, driverId);
+        Metrics::recordSince(Histogram::QUEUE_WAIT_NS, o->created);
+        waitMs += std::chrono::duration<double, std::milli>(now - o->created).count();
+        store->transition(orderId, OrderStatus::ASSIGNED, driverId);
+        // the order itself moves to the driver: into its queue, or alongside its new route stops
+        PooledOrder taken = queueOrders.take(orderId);
+        if(routes.count(driverIdx)) it->second->carryOrder(std::move(taken));
+        else it->second->assignOrder(std::move(taken));
+        surge.orderRemoved(orderId);
+        done++;
     }
-    computeSurgeAndNotify();
+    Metrics::inc(Counter::ASSIGNMENTS, done);
+    Metrics::record(Histogram::ASSIGNMENTS_PER_ROUND, done);
+    Metrics::setGauge(Gauge::ORDERS_QUEUED, (long long)queueOrders.size());
+    round.assigned = done;
+    round.meanWaitMs = done ? waitMs / done : 0.0;
+    return summarize();
 }
@@ -4,46 +4,134 @@
 #include <mutex>
 #include <memory>
 #include <functional>
+#include <atomic>
+#include <chrono>
 #include "models/Order.h"
 #include "models/Driver.h"
 #include "core/Graph.h"
+#include "core/LiveGraph.h"
 #include "core/Scheduler.h"
+#include "core/DriverIndex.h"
+#include "core/LocationFeed.h"
+#include "core/WorkStealer.h"
+#include "core/Repositioner.h"
+#include "core/OrderBook.h"
+#include "core/OrderStore.h"
+#include "core/SurgeEngine.h"
+#include "core/TraceRecorder.h"
 #include "../utils/Logger.h"
+#include "../utils/MpscQueue.h"
 
-// Observer interface for surge/price updates
-struct SurgeObserver {
-    virtual void onSurgeUpdate(double multiplier) = 0;
+// what one dispatch round did, for callers that pace rounds (DispatchService)
+struct DispatchRound {
+    int assigned{0};
+    int remaining{0};                                  // still queued afterwards
+    std::chrono::system_clock::time_point oldest{};    // creation time of the oldest remaining order
+    double meanWaitMs{0};                              // creation -> assignment, over this round's assignments
+    int cancelled{0};                                  // passenger cancels applied, found in the queue
 };
 
-class Dispatcher {
+class Dispatcher : public DriverListener {
 public:
+    // the process-wide dispatcher; a Simulation or a test can run its own instance
     static Dispatcher& instance(){
         static Dispatcher d;
         return d;
     }
 
-    void registerDriver(std::shared_ptr<Driver> drv);
+    Dispatcher() = default;
+    ~Dispatcher(); // stops the worker threads of drivers still registered
+    Dispatcher(const Dispatcher&) = delete;
+    Dispatcher& operator=(const Dispatcher&) = delete;
+
+    // startWorker=false leaves the driver to an external driver loop (e.g. Simulation)
+    void registerDriver(std::shared_ptr<Driver> drv, bool startWorker=true);
     void unregisterDriver(int id);
 
+    // Order intake and driver events never take the dispatcher lock: they are pushed
+    // onto a lock-free inbox and applied in one batch at the start of runDispatch.
     void submitOrder(const Order &o);
     void cancelOrder(int orderId); // external cancel (passenger cancels)
-    void notifyOrderCancelled(int orderId, int driverId); // driver notifies cancellation
-    void notifyOrderCompleted(int orderId, int driverId, int rating);
+    void notifyOrderCancelled(int orderId, int driverId, PooledOrder order) override; // driver notifies cancellation
+    void notifyOrderCompleted(int orderId, int driverId, int rating) override;
+    void notifyDriverMoved(int driverId, int node) override; // keeps the spatial index current
+    void notifyOrderPickedUp(int orderId, int driverId) override;
+    PooledOrder findWork(Driver &idle) override;             // work stealing, when enabled
 
     void setStrategy(std::shared_ptr<AssignmentStrategy> strat);
+    // surge updates arrive from the surge engine's tick thread, not from dispatch
     void addObserver(std::shared_ptr<SurgeObserver> obs);
 
-    void runDispatch(const Graph &g);
+    // persist order state under dir and requeue whatever a previous run left unfinished;
+    // orders this run already holds are carried into the journal unchanged
+    void enableJournal(const std::string &dir);
+
+    // price surge per zone of about zoneSize nodes instead of city-wide
+    void enableZonalSurge(const Graph &g, int zoneSize=256);
+    double surgeMultiplier(int node) const { return surge.multiplierAt(node); }
+
+    // bucket driver positions by graph cell so strategies get k-nearest candidates
+    void enableSpatialIndex(const Graph &g, int cellSize=64);
+
+    // accept raw GPS pings for registered drivers (needs Graph::coords); pings are
+    // coalesced per driver and applied at the start of each dispatch round
+    void enableLocationFeed(const Graph &g);
+    // lock-free; dropped (and counted) before enableLocationFeed
+    void ingestPings(const GpsPing *pings, size_t n);
+    void ingestPings(const std::vector<GpsPing> &pings){ ingestPings(pings.data(), pings.size()); }
+    LocationFeedStats locationStats() const;
+
+    // let idle drivers take orders queued behind a nearby busy driver's trip;
+    // uses the spatial index for neighbours when enabled
+    void enableWorkStealing(const Graph &g, StealPolicy policy = StealPolicy{});
+    void enableWorkStealing(const LiveGraph &g, StealPolicy policy = StealPolicy{});
+
+    // forecast demand per zone from submitted pickups and periodically send idle
+    // drivers toward it; g must outlive the dispatcher
+    void enableRepositioning(const Graph &g, RepositionConfig cfg = RepositionConfig{});
+    void enableRepositioning(const LiveGraph &g, RepositionConfig cfg = RepositionConfig{});
+
+    // record order and driver inputs for TraceReplay, starting with the current fleet
+    // and queue; null stops recording
+    void recordTrace(std::shared_ptr<TraceRecorder> rec);
+
+    DispatchRound runDispatch(const Graph &g);
+    // round on the latest traffic version, pinned until the round ends
+    DispatchRound runDispatch(const LiveGraph &g){ return runDispatch(*g.snapshot()); }
+
+    // orders ever submitted or handed back by drivers; lets a pacing loop see
+    // new queue work without taking the lock
+    uint64_t arrivalCount() const { return arrivals.load(std::memory_order_relaxed); }
 
 private:
-    Dispatcher() {}
+    struct InboxEvent {
+        enum Kind { SUBMIT, CANCEL, DRIVER_CANCELLED, COMPLETED, STOLEN, PICKED_UP } kind;
+        explicit InboxEvent(Kind k): kind(k) {}
+        PooledOrder order; // SUBMIT, and DRIVER_CANCELLED when the driver handed it back
+        int orderId{0};
+        int driverId{0};
+        int rating{0};
+    };
+    MpscQueue<InboxEvent> inbox;
+    std::atomic<uint64_t> arrivals{0};
+
     std::mutex mtx;
     std::map<int, std::shared_ptr<Driver>> drivers;
-    std::vector<Order> queueOrders;
+    OrderBook queueOrders;
+    std::unique_ptr<OrderStore> store = std::make_unique<OrderStore>(); // journal of every unfinished order
     std::shared_ptr<AssignmentStrategy> strategy;
-    std::vector<std::shared_ptr<SurgeObserver>> observers;
+    DriverTable roundTable; // driver state snapshot for the current round, reused across rounds
+    SurgeEngine surge; // fed lock-free from intake, moves and assignments
+    std::shared_ptr<DriverIndex> index; // read lock-free via std::atomic_load from driver threads
+    std::shared_ptr<TraceRecorder> trace; // likewise, from intake and driver threads
+    std::shared_ptr<LocationFeed> feed;   // likewise, from ping producers
+    std::shared_ptr<WorkStealer> stealer; // likewise, from idle driver threads
+    std::shared_ptr<Repositioner> repositioner; // likewise, from intake
+    std::atomic<uint64_t> droppedPings{0}; // arrived before the feed existed
 
-    // compute surge multiplier and notify observers
-    void computeSurgeAndNotify();
-    double lastSurge{1.0};
+    // apply every queued inbox event; caller holds mtx (the single consumer).
+    // Returns the passenger cancels that removed a queued order
+    int drainInbox();
+    void installStealer(std::shared_ptr<WorkStealer> w);
+    void installRepositioner(std::shared_ptr<Repositioner> r);
 };
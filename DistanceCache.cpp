@@ -0,0 +1,68 @@
+#include "DistanceCache.h"
+#include "../utils/Metrics.h"
+
+// bookkeeping per entry besides the pairs: list node, hash node and bucket, control block
+static const size_t ENTRY_OVERHEAD = 128;
+
+DistanceCache::DistanceCache(size_t maxBytes_): maxBytes(maxBytes_) {}
+
+std::shared_ptr<const SearchSpace> DistanceCache::find(int node, uint64_t version){
+    Key k{version, node};
+    Shard &s = shardOf(k);
+    std::lock_guard<std::mutex> lg(s.mtx);
+    auto it = s.where.find(k);
+    if(it == s.where.end()){
+        s.misses++;
+        Metrics::inc(Counter::DISTANCE_CACHE_MISSES);
+        return nullptr;
+    }
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    s.hits++;
+    Metrics::inc(Counter::DISTANCE_CACHE_HITS);
+    return it->second->space;
+}
+
+std::shared_ptr<const SearchSpace> DistanceCache::insert(int node, uint64_t version, const SearchSpace &space){
+    auto copy = std::make_shared<const SearchSpace>(space);
+    size_t bytes = space.size() * sizeof(space[0]) + ENTRY_OVERHEAD;
+    const size_t budget = maxBytes / SHARDS;
+    if(bytes > budget) return copy; // would evict a whole shard for one entry
+
+    Key k{version, node};
+    Shard &s = shardOf(k);
+    std::lock_guard<std::mutex> lg(s.mtx);
+    auto it = s.where.find(k);
+    if(it != s.where.end()) return it->second->space; // another thread searched the same node meanwhile
+    while(s.bytes + bytes > budget && !s.lru.empty()){
+        s.bytes -= s.lru.back().bytes;
+        s.where.erase(s.lru.back().key);
+        s.lru.pop_back();
+        s.evictions++;
+    }
+    s.lru.push_front(Entry{k, copy, bytes});
+    s.where.emplace(k, s.lru.begin());
+    s.bytes += bytes;
+    return copy;
+}
+
+DistanceCacheStats DistanceCache::stats() const {
+    DistanceCacheStats st;
+    for(auto &s: shards){
+        std::lock_guard<std::mutex> lg(s.mtx);
+        st.hits += s.hits;
+        st.misses += s.misses;
+        st.evictions += s.evictions;
+        st.entries += s.lru.size();
+        st.bytes += s.bytes;
+    }
+    return st;
+}
+
+void DistanceCache::clear(){
+    for(auto &s: shards){
+        std::lock_guard<std::mutex> lg(s.mtx);
+        s.lru.clear();
+        s.where.clear();
+        s.bytes = 0;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+// settled (node, distance) pairs of one upward hierarchy search
+using SearchSpace = std::vector<std::pair<int,long long>>;
+
+struct DistanceCacheStats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t evictions{0};
+    size_t entries{0};
+    size_t bytes{0};
+    double hitRate() const { return hits + misses ? (double)hits / (hits + misses) : 0.0; }
+};
+
+// Bounded cache of per-node search results, keyed by (node, graph version) and
+// shared by every query on one graph lineage: a Graph and the LiveGraph versions
+// made from it. A hierarchy query runs one upward search per source and target;
+// drivers parked between rounds and orders still waiting in the queue ask for
+// the same nodes round after round, so their searches are kept until the graph
+// version moves on. Entries of older versions are never hit again and age out.
+//
+// Memory is accounted per entry (payload plus bookkeeping) and kept under the
+// budget by evicting least recently used entries. Lookups lock one of SHARDS
+// shards, each with its own LRU list and a share of the budget.
+class DistanceCache {
+public:
+    explicit DistanceCache(size_t maxBytes = size_t(64) << 20);
+
+    // cached search from node under version, or null
+    std::shared_ptr<const SearchSpace> find(int node, uint64_t version);
+    // store a copy of space; returns what the cache now holds for the key
+    std::shared_ptr<const SearchSpace> insert(int node, uint64_t version, const SearchSpace &space);
+
+    DistanceCacheStats stats() const;
+    size_t capacity() const { return maxBytes; }
+    void clear();
+
+private:
+    static const int SHARDS = 16;
+
+    struct Key {
+        uint64_t version;
+        int node;
+        bool operator==(const Key &o) const { return version == o.version && node == o.node; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &k) const { return std::hash<uint64_t>()(k.version * 0x9E3779B97F4A7C15ull ^ (uint32_t)k.node); }
+    };
+    struct Entry {
+        Key key;
+        std::shared_ptr<const SearchSpace> space;
+        size_t bytes;
+    };
+    struct Shard {
+        mutable std::mutex mtx;
+        std::list<Entry> lru; // most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> where;
+        size_t bytes{0};
+        uint64_t hits{0}, misses{0}, evictions{0};
+    };
+
+    size_t maxBytes;
+    Shard shards[SHARDS];
+
+    Shard& shardOf(const Key &k){ return shards[KeyHash()(k) % SHARDS]; }
+};
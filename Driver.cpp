@@ -4,6 +4,7 @@
 #include <random>
 #include "../core/Dispatcher.h" // circular dependency ok here due to include order in build
 #include "../utils/Logger.h"
+#include "../utils/Metrics.h"
 
 Driver::Driver(int id_, int loc): id(id_), location(loc), active(true) {}
 
@@ -20,17 +21,97 @@ void Driver::stop(){
     if(worker.joinable()) worker.join();
 }
 
-void Driver::assignOrder(const Order &o){
+void Driver::assignOrder(PooledOrder o){
+    if(!o) return;
+    tasks.push(std::move(o));
+    { std::lock_guard<std::mutex> lg(mtx); } // a worker between its check and its wait sees the order
+    cv.notify_one();
+}
+
+void Driver::setLocation(int node){
+    location.store(node);
+    owner().notifyDriverMoved(id, node);
+}
+
+PooledOrder Driver::takeNext(){
+    auto o = tasks.pop();
+    return o ? std::move(*o) : PooledOrder();
+}
+
+std::optional<Order> Driver::newestQueued() const {
+    std::optional<Order> out;
+    tasks.peekBack([&](const PooledOrder &o){ out = *o; });
+    return out;
+}
+
+PooledOrder Driver::stealQueued(int orderId){
+    auto o = tasks.stealIf([&](const PooledOrder &p){ return p->id == orderId; });
+    return o ? std::move(*o) : PooledOrder();
+}
+
+int Driver::pending(){
+    std::lock_guard<std::mutex> lg(mtx);
+    int n = tasks.size();
+    for(auto &s: plan.stops) if(!s.pickup) n++;
+    return n;
+}
+
+void Driver::enablePooling(PoolingLimits limits){
+    std::lock_guard<std::mutex> lg(mtx);
+    plan.limits = limits;
+    if(plan.stops.empty()) plan.origin = location.load();
+    poolingOn.store(true);
+}
+
+RoutePlan Driver::route() const {
+    std::lock_guard<std::mutex> lg(mtx);
+    RoutePlan p = plan;
+    if(p.origin < 0) p.origin = location.load(); // nothing served yet
+    return p;
+}
+
+bool Driver::updateRoute(const RoutePlan &p){
     {
         std::lock_guard<std::mutex> lg(mtx);
-        tasks.push(o);
+        if(p.version != plan.version) return false;
+        plan.origin = p.origin;
+        plan.stops = p.stops;
+        plan.onboard = p.onboard;
+        plan.version++;
     }
     cv.notify_one();
+    return true;
 }
 
-int Driver::pending(){
+void Driver::carryOrder(PooledOrder o){
+    if(!o) return;
     std::lock_guard<std::mutex> lg(mtx);
-    return (int)tasks.size();
+    bool onRoute = false, pickedUp = true;
+    for(auto &st: plan.stops){
+        if(st.orderId != o->id) continue;
+        onRoute = true;
+        if(st.pickup) pickedUp = false;
+    }
+    if(!onRoute) return; // cancelled before it got here: released on return
+    if(pickedUp) o->status = OrderStatus::IN_PROGRESS;
+    int orderId = o->id;
+    carried[orderId] = std::move(o);
+}
+
+PooledOrder Driver::removeFromRoute(int orderId){
+    PooledOrder out;
+    auto it = carried.find(orderId);
+    if(it != carried.end()){
+        out = std::move(it->second);
+        carried.erase(it);
+    }
+    auto &st = plan.stops;
+    for(size_t k=0;k<st.size();){
+        if(st[k].orderId != orderId){ k++; continue; }
+        if(k + 1 < st.size()) st[k+1].leg += st[k].leg; // keep driving through the dropped stop's node
+        st.erase(st.begin() + k);
+    }
+    return out;
 }
 
 void Driver::addRating(int r){
@@ -38,6 +119,11 @@ void Driver::addRating(int r){
     ratingCount += 1;
 }
 
+void Driver::restoreRating(int sum, int count){
+    ratingSum = sum;
+    ratingCount = count;
+}
+
 double Driver::getRating() const{
     int cnt = ratingCount.load();
     if(cnt==0) return 5.0; // default neutral high rating
@@ -45,77 +131,202 @@ double Driver::getRating() const{
 }
 
 void Driver::simulateCancelCurrent(){
+    if(poolingOn.load()){
+        // cancel the first passenger not yet picked up
+        std::lock_guard<std::mutex> lg(mtx);
+        for(auto &s: plan.stops){
+            if(!s.pickup) continue;
+            int orderId = s.orderId;
+            PooledOrder o = removeFromRoute(orderId);
+            plan.version++;
+            LOG_INFO("Driver {} simulated cancellation of Order {}", id, orderId);
+            notifyCancellation(orderId, std::move(o));
+            return;
+        }
+        LOG_INFO("Driver {} had no active task to cancel.", id);
+        return;
+    }
     // For simplicity, if driver is busy, we trigger cancellation notification
     if(busy.load()){
-        std::lock_guard<std::mutex> lg(mtx);
-        if(!tasks.empty()){
-            // attempt to cancel front task
-            Order o = tasks.front();
-            tasks.pop();
-            Logger::info("Driver " + std::to_string(id) + " simulated cancellation of Order " + std::to_string(o.id));
-            notifyCancellation(o.id);
+        // attempt to cancel front task
+        if(auto o = takeNext()){
+            LOG_INFO("Driver {} simulated cancellation of Order {}", id, o->id);
+            int orderId = o->id;
+            notifyCancellation(orderId, std::move(o));
             return;
         }
     }
     // else nothing to cancel
-    Logger::info("Driver " + std::to_string(id) + " had no active task to cancel.");
+    LOG_INFO("Driver {} had no active task to cancel.", id);
 }
 
-void Driver::notifyCancellation(int orderId){
-    // use dispatcher singleton
-    Dispatcher::instance().notifyOrderCancelled(orderId, id);
+DriverListener& Driver::owner(){
+    DriverListener *l = listener.load();
+    return l ? *l : Dispatcher::instance();
+}
+
+void Driver::notifyCancellation(int orderId, PooledOrder order){
+    owner().notifyOrderCancelled(orderId, id, std::move(order));
 }
 
 void Driver::notifyCompletion(int orderId, int rating){
-    Dispatcher::instance().notifyOrderCompleted(orderId, id, rating);
+    owner().notifyOrderCompleted(orderId, id, rating);
 }
 
 void Driver::loop(){
     std::mt19937 rng(std::random_device{}());
     std::uniform_int_distribution<int> cancelChance(0, 99);
+    bool routeBusy = false; // pooling: busy from the first stop until the route runs empty
+    auto routeSince = std::chrono::steady_clock::now();
 
     while(running.load()){
-        Order current(0,0,0,0.0);
-        {
-            std::unique_lock<std::mutex> lk(mtx);
-            if(tasks.empty()){
-                cv.wait_for(lk, std::chrono::milliseconds(500));
-                if(!running.load()) break;
-                continue;
+        if(poolingOn.load()){
+            bool served = serveNextStop(rng);
+            if(served && !routeBusy){
+                routeBusy = true;
+                busy.store(true);
+                Metrics::addGauge(Gauge::DRIVERS_BUSY, 1);
+                routeSince = std::chrono::steady_clock::now();
+            } else if(!served && routeBusy){
+                routeBusy = false;
+                busy.store(false);
+                Metrics::addGauge(Gauge::DRIVERS_BUSY, -1);
+                Metrics::inc(Counter::DRIVER_BUSY_NS, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - routeSince).count());
             }
-            current = tasks.front();
-            tasks.pop();
+            continue;
         }
+        PooledOrder next = takeNext();
+        if(!next) next = owner().findWork(*this); // idle: take over a neighbour's queued order
+        if(!next && relocating()){
+            driveToRelocation();
+            continue;
+        }
+        if(!next){
+            std::unique_lock<std::mutex> lk(mtx);
+            cv.wait_for(lk, std::chrono::milliseconds(500), [this]{ return !tasks.empty() || !running.load(); });
+            if(!running.load()) break;
+            continue;
+        }
+        Order &current = *next; // ours until the end of this iteration, then released
         busy.store(true);
+        Metrics::addGauge(Gauge::DRIVERS_BUSY, 1);
+        auto busySince = std::chrono::steady_clock::now();
+        auto idle = [&]{
+            busy.store(false);
+            Metrics::addGauge(Gauge::DRIVERS_BUSY, -1);
+            Metrics::inc(Counter::DRIVER_BUSY_NS, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - busySince).count());
+        };
         // simulate travel times
         int from = location.load();
         long long d1 = std::llabs(from - current.pickup) * 200;
         long long d2 = std::llabs(current.pickup - current.dropoff) * 200;
 
-        Logger::info("Driver " + std::to_string(id) + " assigned Order " + std::to_string(current.id));
+        LOG_INFO("Driver {} assigned Order {}", id, current.id);
         simulateTravel(d1);
-        location.store(current.pickup);
-        Logger::info("Driver " + std::to_string(id) + " picked Order " + std::to_string(current.id));
+        setLocation(current.pickup);
+        current.status = OrderStatus::IN_PROGRESS;
+        LOG_INFO("Driver {} picked Order {}", id, current.id);
+        owner().notifyOrderPickedUp(current.id, id);
 
         // random chance to cancel mid-way (simulate driver cancellation)
         if(cancelChance(rng) < 10){ // 10% chance
-            Logger::info("Driver " + std::to_string(id) + " cancelled Order " + std::to_string(current.id));
-            notifyCancellation(current.id);
-            busy.store(false);
+            LOG_INFO("Driver {} cancelled Order {}", id, current.id);
+            notifyCancellation(current.id, std::move(next));
+            idle();
             continue;
         }
 
         simulateTravel(d2);
-        location.store(current.dropoff);
-        Logger::info("Driver " + std::to_string(id) + " delivered Order " + std::to_string(current.id));
+        setLocation(current.dropoff);
+        LOG_INFO("Driver {} delivered Order {}", id, current.id);
 
         // simulate passenger rating 3..5
         int rating = 3 + (rng()%3);
         addRating(rating);
         notifyCompletion(current.id, rating);
-        busy.store(false);
+        idle();
+    }
+    if(routeBusy) Metrics::addGauge(Gauge::DRIVERS_BUSY, -1);
+    LOG_INFO("Driver {} stopping.", id);
+}
+
+bool Driver::serveNextStop(std::mt19937 &rng){
+    RouteStop stop;
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        if(plan.stops.empty()){
+            cv.wait_for(lk, std::chrono::milliseconds(500));
+            return false;
+        }
+        // commit to the next stop: from here on insertions go after it
+        stop = plan.stops.front();
+        plan.stops.erase(plan.stops.begin());
+        // passengers aboard during this leg use up part of their detour budget
+        auto aboard = [&](int orderId){
+            if(stop.pickup && stop.orderId == orderId) return false;
+            for(auto &s: plan.stops) if(s.pickup && s.orderId == orderId) return false;
+            return true;
+        };
+        for(auto &s: plan.stops) if(!s.pickup && aboard(s.orderId)) s.budget -= stop.leg;
+        plan.origin = stop.node;
+        plan.onboard += stop.pickup ? 1 : -1;
+        plan.version++;
+    }
+
+    simulateTravel(stop.leg * 200);
+    setLocation(stop.node);
+    if(stop.pickup){
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            auto it = carried.find(stop.orderId);
+            if(it != carried.end()) it->second->status = OrderStatus::IN_PROGRESS;
+        }
+        LOG_INFO("Driver {} picked Order {}", id, stop.orderId);
+        owner().notifyOrderPickedUp(stop.orderId, id);
+        if(rng() % 100 < 10){ // same 10% driver cancellation as the FIFO loop
+            PooledOrder o;
+            {
+                std::lock_guard<std::mutex> lg(mtx);
+                o = removeFromRoute(stop.orderId);
+                plan.onboard--;
+                plan.version++;
+            }
+            LOG_INFO("Driver {} cancelled Order {}", id, stop.orderId);
+            notifyCancellation(stop.orderId, std::move(o));
+        }
+        return true;
+    }
+    LOG_INFO("Driver {} delivered Order {}", id, stop.orderId);
+    {
+        std::lock_guard<std::mutex> lg(mtx);
+        carried.erase(stop.orderId);
+    }
+    int rating = 3 + (rng()%3);
+    addRating(rating);
+    notifyCompletion(stop.orderId, rating);
+    return true;
+}
+
+void Driver::relocate(int node){
+    relocateTo.store(node);
+    { std::lock_guard<std::mutex> lg(mtx); }
+    cv.notify_one();
+}
+
+void Driver::driveToRelocation(){
+    int target = relocateTo.load();
+    long long millis = std::min<long long>(3000, std::llabs(location.load() - target) * 200);
+    bool interrupted;
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        interrupted = cv.wait_for(lk, std::chrono::milliseconds(millis), [this]{ return !tasks.empty() || !running.load(); });
+    }
+    // interrupted: stay put and serve the order; a later tick may send the driver again
+    if(!interrupted){
+        setLocation(target);
+        LOG_INFO("Driver {} repositioned to node {}", id, target);
     }
-    Logger::info("Driver " + std::to_string(id) + " stopping.");
+    relocateTo.compare_exchange_strong(target, -1);
 }
 
 void Driver::simulateTravel(long long millis){
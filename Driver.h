@@ -3,11 +3,29 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
 #include <iostream>
 #include <optional>
 #include <vector>
+#include <unordered_map>
+#include <random>
 #include "Order.h"
+#include "OrderPool.h"
+#include "RoutePlan.h"
+#include "../utils/WorkDeque.h"
+
+class Driver;
+
+// Receiver of a driver's lifecycle notifications (Dispatcher, ShardedDispatcher)
+struct DriverListener {
+    virtual ~DriverListener() = default;
+    // the driver hands the order back, so the requeued order is the same pool slot
+    virtual void notifyOrderCancelled(int orderId, int driverId, PooledOrder order) = 0;
+    virtual void notifyOrderCompleted(int orderId, int driverId, int rating) = 0;
+    virtual void notifyDriverMoved(int driverId, int node) = 0;
+    virtual void notifyOrderPickedUp(int orderId, int driverId){ (void)orderId; (void)driverId; }
+    // an idle driver asks for an order another driver has queued but not started
+    virtual PooledOrder findWork(Driver &idle){ (void)idle; return PooledOrder(); }
+};
 
 class Driver {
 public:
@@ -21,15 +39,51 @@ public:
     void start();
     void stop();
 
-    // assign an order to driver (thread-safe)
-    void assignOrder(const Order &o);
+    // assign an order to driver (thread-safe); the driver owns it until done
+    void assignOrder(PooledOrder o);
+    void assignOrder(const Order &o){ assignOrder(OrderPool::instance().acquire(o)); }
+
+    // where notifications go; null means the Dispatcher singleton
+    void setListener(DriverListener *l){ listener.store(l); }
+
+    // move the driver and let the dispatcher re-index it
+    void setLocation(int node);
+
+    // pop the next queued order, empty if none (used by the worker loop and by Simulation)
+    PooledOrder takeNext();
+
+    // Pooling: the driver follows a route of pickup/dropoff stops and may carry
+    // several passengers. Orders reach it through updateRoute() instead of
+    // assignOrder(); takeNext() and Simulation only see the FIFO queue.
+    void enablePooling(PoolingLimits limits);
+    bool pooling() const { return poolingOn.load(); }
+    RoutePlan route() const;
+    // install a plan derived from route(); false if the route has moved on since
+    bool updateRoute(const RoutePlan &plan);
+    // hand over the order behind newly installed stops; held until its dropoff or cancellation
+    void carryOrder(PooledOrder o);
+
+    // work stealing: orders queued behind the current trip can move to an idle driver
+    int queued() const { return tasks.size(); }
+    bool serving() const { return busy.load(); }
+    std::optional<Order> newestQueued() const; // a copy, to decide on
+    // take the newest queued order if it is still orderId; the caller now owns it
+    PooledOrder stealQueued(int orderId);
+
+    // repositioning: an idle driver drives to node unless an order arrives first
+    void relocate(int node);
+    bool relocating() const { return relocateTo.load() >= 0; }
 
-    // driver current pending count
+    // driver current pending count (orders not yet delivered when pooling)
     int pending();
 
     // rating update (called by dispatcher after delivery)
     void addRating(int r);
     double getRating() const;
+    // raw stats, so a trace can carry a driver's history over exactly
+    int ratingTotal() const { return ratingSum.load(); }
+    int ratedTrips() const { return ratingCount.load(); }
+    void restoreRating(int sum, int count);
 
     // try to cancel an order currently being processed (for simulation)
     void simulateCancelCurrent();
@@ -38,17 +92,26 @@ private:
     std::thread worker;
     mutable std::mutex mtx;
     std::condition_variable cv;
-    std::queue<Order> tasks;
+    WorkDeque<PooledOrder> tasks; // own lock; mtx/cv only wake the worker
+    std::atomic<bool> poolingOn{false};
+    RoutePlan plan; // guarded by mtx
+    std::unordered_map<int, PooledOrder> carried; // orders on the route, guarded by mtx
     std::atomic<bool> running{false};
     std::atomic<bool> busy{false};
+    std::atomic<int> relocateTo{-1};
+    std::atomic<DriverListener*> listener{nullptr};
 
     // rating stats
     std::atomic<int> ratingSum{0};
     std::atomic<int> ratingCount{0};
 
     void loop();
+    bool serveNextStop(std::mt19937 &rng); // pooling mode; false when the route is empty
+    PooledOrder removeFromRoute(int orderId); // caller holds mtx; returns the carried order
     void simulateTravel(long long millis);
-    // notify dispatcher on cancellation or completion by calling singleton
-    void notifyCancellation(int orderId);
+    void driveToRelocation(); // idle only; gives up as soon as an order is queued
+    DriverListener& owner();
+    // notify dispatcher on cancellation or completion
+    void notifyCancellation(int orderId, PooledOrder order);
     void notifyCompletion(int orderId, int rating);
 };
@@ -0,0 +1,52 @@
+#include "DriverIndex.h"
+#include <queue>
+#include <functional>
+
+DriverIndex::DriverIndex(const Graph &g, int cellSize): part(g, cellSize), members(part.cellCount()) {}
+
+void DriverIndex::update(int driverId, int node){
+    int c = part.cell(node);
+    std::lock_guard<std::mutex> lg(mtx);
+    auto it = where.find(driverId);
+    if(it != where.end()){
+        if(it->second.first == c) return;
+        // swap-remove from the old cell
+        auto &old = members[it->second.first];
+        int slot = it->second.second;
+        old[slot] = old.back();
+        where[old[slot]].second = slot;
+        old.pop_back();
+        where.erase(driverId);
+    }
+    if(c < 0) return;
+    where[driverId] = {c, (int)members[c].size()};
+    members[c].push_back(driverId);
+}
+
+void DriverIndex::remove(int driverId){
+    update(driverId, -1);
+}
+
+std::vector<int> DriverIndex::nearest(int node, int k) const {
+    std::vector<int> out;
+    int start = part.cell(node);
+    if(start < 0 || k <= 0) return out;
+    using P = std::pair<long long,int>;
+    std::priority_queue<P, std::vector<P>, std::greater<P>> pq;
+    std::unordered_map<int,long long> dist;
+    dist[start] = 0; pq.push({0, start});
+    std::lock_guard<std::mutex> lg(mtx);
+    while(!pq.empty() && (int)out.size() < k){
+        auto [d,c] = pq.top(); pq.pop();
+        if(d != dist[c]) continue;
+        out.insert(out.end(), members[c].begin(), members[c].end());
+        for(auto &e: part.cellAdj[c]){
+            auto it = dist.find(e.first);
+            if(it == dist.end() || d + e.second < it->second){
+                dist[e.first] = d + e.second;
+                pq.push({d + e.second, e.first});
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include "GraphPartition.h"
+
+// Spatial index of driver positions bucketed by GraphPartition cell.
+// Kept current by the Dispatcher as drivers move; strategies use nearest()
+// to get a short candidate list instead of scanning the whole fleet.
+class DriverIndex {
+public:
+    DriverIndex(const Graph &g, int cellSize=64);
+
+    void update(int driverId, int node);
+    void remove(int driverId);
+
+    // at least k drivers (when the fleet has that many) around node, found by
+    // visiting cells in order of cell-graph distance; whole cells are taken
+    std::vector<int> nearest(int node, int k) const;
+
+    const GraphPartition& partition() const { return part; }
+
+private:
+    GraphPartition part;
+    std::vector<std::vector<int>> members;                  // cell -> driver ids
+    std::unordered_map<int, std::pair<int,int>> where;      // driver -> (cell, slot in members)
+    mutable std::mutex mtx;
+};
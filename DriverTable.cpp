@@ -0,0 +1,19 @@
+#include "DriverTable.h"
+#include "../models/Driver.h"
+
+void DriverTable::build(const std::vector<std::shared_ptr<Driver>>& drivers){
+    const size_t n = drivers.size();
+    id.resize(n);
+    location.resize(n);
+    pending.resize(n);
+    rating.resize(n);
+    available.resize(n);
+    for(size_t i=0;i<n;i++){
+        Driver &d = *drivers[i];
+        id[i] = d.id;
+        location[i] = d.location.load(std::memory_order_relaxed);
+        pending[i] = d.pending();
+        rating[i] = d.getRating();
+        available[i] = d.active.load(std::memory_order_relaxed) ? 1 : 0;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class Driver;
+
+// Structure-of-arrays snapshot of driver state, taken once per dispatch round
+// so scoring loops read contiguous arrays instead of locking each Driver.
+// Row i describes drivers[i] of the vector it was built from.
+struct DriverTable {
+    std::vector<int> id;
+    std::vector<int> location;
+    std::vector<int32_t> pending;   // queued orders
+    std::vector<double> rating;
+    std::vector<int32_t> available; // 1 if the driver takes orders
+
+    // refill from drivers, reusing capacity across rounds
+    void build(const std::vector<std::shared_ptr<Driver>>& drivers);
+    size_t size() const { return id.size(); }
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Read-only contiguous array that either owns its elements or borrows them from
+// shared storage (e.g. a memory-mapped graph file) kept alive by a shared_ptr.
+// Copies share the elements.
+template<typename T>
+class FlatArray {
+public:
+    FlatArray() = default;
+    FlatArray(std::vector<T> v){
+        auto owned = std::make_shared<std::vector<T>>(std::move(v));
+        ptr = owned->data();
+        len = owned->size();
+        keep = std::move(owned);
+    }
+    FlatArray(const T *p, size_t n, std::shared_ptr<const void> owner): keep(std::move(owner)), ptr(p), len(n) {}
+
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + len; }
+
+private:
+    std::shared_ptr<const void> keep;
+    const T *ptr{nullptr};
+    size_t len{0};
+};
@@ -0,0 +1,100 @@
+#include "Graph.h"
+#include "ContractionHierarchy.h"
+#include "CsrGraph.h"
+#include "SearchWorkspace.h"
+#include "DistanceCache.h"
+#include "../utils/Metrics.h"
+#include "../utils/ThreadPool.h"
+#include <numeric>
+#include <algorithm>
+
+CsrGraph::CsrGraph(const Graph &g): n(g.n) {
+    std::vector<int> off(g.n + 1, 0);
+    for(int u=0;u<n;u++) off[u+1] = off[u] + (int)g.adj[u].size();
+    std::vector<int> tgt(off[n]), w(off[n]);
+    for(int u=0;u<n;u++){
+        int k = off[u];
+        for(auto &e: g.adj[u]){ tgt[k] = e.first; w[k] = e.second; k++; }
+    }
+    offsets = std::move(off);
+    targets = std::move(tgt);
+    weights = std::move(w);
+}
+
+void Graph::freeze(){
+    // addEdge drops csr, so an existing one always matches the edges
+    if(!csr) csr = std::make_shared<const CsrGraph>(*this);
+}
+
+void Graph::preprocess(){
+    freeze();
+    if(!ch) ch = std::make_shared<const ContractionHierarchy>(*this);
+}
+
+void Graph::enableDistanceCache(size_t maxBytes){
+    cache = std::make_shared<DistanceCache>(maxBytes);
+}
+
+void Graph::thaw(){
+    adj.assign(n, {});
+    if(!csr) return;
+    for(int u=0;u<n;u++){
+        adj[u].reserve(csr->offsets[u+1] - csr->offsets[u]);
+        forEachNeighbour(u, [&](int v, int w){ adj[u].push_back({v, w}); });
+    }
+}
+
+std::vector<long long> Graph::distanceTable(const std::vector<int>& sources, const std::vector<int>& targets,
+                                            ThreadPool *pool) const {
+    METRICS_TIMER(Histogram::SHORTEST_PATH_NS);
+    if(ch) return ch->manyToMany(sources, targets, cache.get(), version, pool);
+    std::vector<long long> result(sources.size() * targets.size(), INF);
+    // source rows split across the pool (the workspace is per thread)
+    ThreadPool::forSlices(pool, sources.size(), [&](int, size_t begin, size_t end){
+        if(csr){
+            auto &ws = SearchWorkspace::local(n);
+            for(size_t i=begin;i<end;i++) ws.distances(*csr, sources[i], targets, &result[i*targets.size()]);
+            return;
+        }
+        for(size_t i=begin;i<end;i++){
+            int s = sources[i];
+            if(s<0 || s>=n) continue;
+            auto dist = dijkstra(s);
+            for(size_t j=0;j<targets.size();j++){
+                int t = targets[j];
+                if(t>=0 && t<n) result[i*targets.size() + j] = dist[t];
+            }
+        }
+    });
+    return result;
+}
+
+std::vector<long long> Graph::pairDistances(const std::vector<std::pair<int,int>>& pairs, ThreadPool *pool) const {
+    if(ch){
+        METRICS_TIMER(Histogram::SHORTEST_PATH_NS);
+        return ch->pairDistances(pairs, cache.get(), version, pool);
+    }
+    // one search per distinct source, to that source's targets only
+    std::vector<int> order(pairs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b){ return pairs[a].first < pairs[b].first; });
+    std::vector<int> sources;
+    std::vector<std::vector<int>> targets;
+    for(size_t k=0;k<order.size();k++){
+        if(k == 0 || pairs[order[k]].first != pairs[order[k-1]].first){
+            sources.push_back(pairs[order[k]].first);
+            targets.emplace_back();
+        }
+        targets.back().push_back(pairs[order[k]].second);
+    }
+    std::vector<long long> result(pairs.size(), INF);
+    ThreadPool::forSlices(pool, sources.size(), [&](int, size_t begin, size_t end){
+        size_t k = 0;
+        for(size_t i=0;i<begin;i++) k += targets[i].size();
+        for(size_t i=begin;i<end;i++){
+            auto row = distanceTable({sources[i]}, targets[i]);
+            for(long long d: row) result[order[k++]] = d;
+        }
+    });
+    return result;
+}
@@ -3,18 +3,49 @@
 #include <queue>
 #include <limits>
 #include <utility>
+#include <memory>
+#include <cstdint>
+#include "CsrGraph.h"
+#include "../utils/FlatArray.h"
+
+class ContractionHierarchy;
+class DistanceCache;
+class ThreadPool;
+
+struct NodeCoord { float lat, lon; };
 
 struct Graph {
+    static constexpr long long INF = std::numeric_limits<long long>::max()/4;
+
     int n;
-    std::vector<std::vector<std::pair<int,int>>> adj; // to, weight
+    // to, weight; left empty for a graph mapped from a GraphFile until addEdge needs it
+    std::vector<std::vector<std::pair<int,int>>> adj;
+    std::shared_ptr<const CsrGraph> csr; // frozen adjacency, built by freeze()
+    std::shared_ptr<const ContractionHierarchy> ch; // routing index, built by preprocess()
+    FlatArray<NodeCoord> coords; // optional node positions, empty when unknown
+    uint64_t version{0}; // weight version, bumped by LiveGraph for every published batch
+    std::shared_ptr<DistanceCache> cache; // hierarchy searches by (node, version), shared with copies and LiveGraph versions
     Graph(int n_=0): n(n_), adj(n_) {}
     void addEdge(int u,int v,int w){
         if(u<0||v<0||u>=n||v>=n) return;
+        if((int)adj.size() != n) thaw();
         adj[u].push_back({v,w});
         adj[v].push_back({u,w});
+        csr.reset(); // derived forms no longer match the edges
+        ch.reset();
+        cache.reset();
     }
+    // calls f(to, weight) for every edge of u, from the CSR arrays when frozen
+    template<typename F>
+    void forEachNeighbour(int u, F &&f) const {
+        if(csr){
+            for(int k=csr->offsets[u];k<csr->offsets[u+1];k++) f(csr->targets[k], csr->weights[k]);
+        } else {
+            for(auto &e: adj[u]) f(e.first, e.second);
+        }
+    }
+
     std::vector<long long> dijkstra(int src) const {
-        const long long INF = std::numeric_limits<long long>::max()/4;
         std::vector<long long> dist(n, INF);
         using P = std::pair<long long,int>;
         std::priority_queue<P, std::vector<P>, std::greater<P>> pq;
@@ -22,14 +53,37 @@ struct Graph {
         while(!pq.empty()){
             auto [d,u]=pq.top(); pq.pop();
             if(d!=dist[u]) continue;
-            for(auto &e: adj[u]){
-                int v=e.first, w=e.second;
+            forEachNeighbour(u, [&](int v, int w){
                 if(dist[v] > d + w){
                     dist[v] = d + w;
                     pq.push({dist[v], v});
                 }
-            }
+            });
         }
         return dist;
     }
+
+    // build the CSR form used by allocation-free searches (no-op if already frozen)
+    void freeze();
+
+    // freeze() plus the contraction hierarchy; call once all edges are added
+    void preprocess();
+
+    // keep up to maxBytes of hierarchy searches for distanceTable to reuse while the
+    // version stays the same; dropped by addEdge. No effect without a hierarchy
+    void enableDistanceCache(size_t maxBytes = size_t(64) << 20);
+
+    // distances from every source to every target, row-major (sources x targets).
+    // Uses the contraction hierarchy when present, otherwise one search per source:
+    // the early-terminating CSR workspace if frozen, plain dijkstra() if not.
+    // A pool splits the work across its workers.
+    std::vector<long long> distanceTable(const std::vector<int>& sources, const std::vector<int>& targets,
+                                         ThreadPool *pool = nullptr) const;
+
+    // distance of each (source, target) pair, for a few entries out of a large table
+    std::vector<long long> pairDistances(const std::vector<std::pair<int,int>>& pairs, ThreadPool *pool = nullptr) const;
+
+private:
+    // rebuild adjacency lists from the CSR arrays (mapped graphs start without them)
+    void thaw();
 };
@@ -0,0 +1,150 @@
+#include "GraphFile.h"
+#include "ContractionHierarchy.h"
+#include "../utils/MappedFile.h"
+#include "../utils/Logger.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace GraphFile {
+
+namespace {
+
+const char MAGIC[8] = {'R','H','G','R','A','P','H','\0'};
+// 2: each node's upward hierarchy edges are sorted by target (LiveGraph binary
+// searches them in place); version 1 files are rejected, rerun graphconv
+const uint32_t VERSION = 2;
+const uint32_t ENDIAN_MARK = 0x01020304;
+const uint64_t ALIGN = 64;
+
+enum Section { OFFSETS, TARGETS, WEIGHTS, COORDS, RANK, UP_OFFSET, UP_TARGET, UP_WEIGHT, SECTION_COUNT };
+
+struct SectionRef { uint64_t offset, bytes; };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    int64_t nodes;
+    int64_t arcs;       // CSR entries (each undirected edge appears twice)
+    int64_t upArcs;     // hierarchy upward edges, 0 without a hierarchy
+    uint64_t shortcuts;
+    SectionRef sections[SECTION_COUNT];
+};
+
+uint64_t alignUp(uint64_t x){ return (x + ALIGN - 1) / ALIGN * ALIGN; }
+
+// section contents as an array that shares ownership of the mapping
+template<typename T>
+FlatArray<T> view(const std::shared_ptr<const MappedFile> &file, const SectionRef &r){
+    return FlatArray<T>((const T*)(file->data() + r.offset), r.bytes / sizeof(T), file);
+}
+
+} // namespace
+
+bool write(const Graph &g, const std::string &path){
+    std::shared_ptr<const CsrGraph> csr = g.csr;
+    if(!csr) csr = std::make_shared<const CsrGraph>(g);
+    const ContractionHierarchy *ch = g.ch.get();
+
+    // each section as the contiguous pieces it is stored in
+    struct Piece { const void *data; uint64_t bytes; };
+    struct Blob {
+        std::vector<Piece> pieces;
+        uint64_t bytes = 0;
+        void add(const void *p, uint64_t n){ if(n){ pieces.push_back({p, n}); bytes += n; } }
+    };
+    auto flat = [](const auto &a){ Blob b; b.add(a.data(), a.size() * sizeof(a[0])); return b; };
+    auto chunked = [](const auto &a){
+        Blob b;
+        for(size_t c=0;c<a.chunkCount();c++) b.add(a.chunk(c), a.chunkSize(c) * sizeof(a[0]));
+        return b;
+    };
+    Blob blobs[SECTION_COUNT] = {
+        flat(csr->offsets), flat(csr->targets), chunked(csr->weights), flat(g.coords),
+        ch ? flat(ch->ranks()) : Blob(), ch ? flat(ch->upOffsets()) : Blob(),
+        ch ? flat(ch->upTargets()) : Blob(), ch ? chunked(ch->upWeights()) : Blob(),
+    };
+
+    Header h;
+    std::memset(&h, 0, sizeof h);
+    std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+    h.version = VERSION;
+    h.endian = ENDIAN_MARK;
+    h.nodes = g.n;
+    h.arcs = csr->edgeCount();
+    h.upArcs = ch ? (int64_t)ch->upTargets().size() : 0;
+    h.shortcuts = ch ? ch->shortcutCount() : 0;
+    uint64_t pos = alignUp(sizeof(Header));
+    for(int s=0;s<SECTION_COUNT;s++){
+        h.sections[s] = {blobs[s].bytes ? pos : 0, blobs[s].bytes};
+        pos = alignUp(pos + blobs[s].bytes);
+    }
+
+    // write to a temp name and rename, so a crash never leaves a truncated graph behind
+    std::string tmp = path + ".tmp";
+    FILE *f = std::fopen(tmp.c_str(), "wb");
+    if(!f) return false;
+    static const char zeros[ALIGN] = {};
+    bool ok = std::fwrite(&h, sizeof h, 1, f) == 1;
+    uint64_t at = sizeof h;
+    for(int s=0;s<SECTION_COUNT && ok;s++){
+        if(!blobs[s].bytes) continue;
+        ok = std::fwrite(zeros, 1, h.sections[s].offset - at, f) == h.sections[s].offset - at;
+        for(auto &p: blobs[s].pieces) ok = ok && std::fwrite(p.data, 1, p.bytes, f) == p.bytes;
+        at = h.sections[s].offset + blobs[s].bytes;
+    }
+    ok = std::fclose(f) == 0 && ok;
+    if(!ok || std::rename(tmp.c_str(), path.c_str()) != 0){
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+Graph map(const std::string &path){
+    auto file = MappedFile::open(path);
+    if(!file || file->size() < sizeof(Header)) return Graph();
+    Header h;
+    std::memcpy(&h, file->data(), sizeof h);
+    if(std::memcmp(h.magic, MAGIC, sizeof MAGIC) != 0 || h.endian != ENDIAN_MARK) return Graph();
+    if(h.version != VERSION){
+        LOG_ERROR("Graph file {} has format version {}, expected {}; convert it again with graphconv", path, h.version, VERSION);
+        return Graph();
+    }
+    if(h.nodes <= 0 || h.nodes > INT32_MAX || h.arcs < 0 || h.arcs > INT32_MAX || h.upArcs < 0 || h.upArcs > INT32_MAX) return Graph();
+
+    const uint64_t n = (uint64_t)h.nodes;
+    const uint64_t expected[SECTION_COUNT] = {
+        (n + 1) * sizeof(int), (uint64_t)h.arcs * sizeof(int), (uint64_t)h.arcs * sizeof(int), n * sizeof(NodeCoord),
+        n * sizeof(int), (n + 1) * sizeof(int), (uint64_t)h.upArcs * sizeof(int), (uint64_t)h.upArcs * sizeof(long long),
+    };
+    const bool hasCh = h.sections[RANK].bytes != 0;
+    for(int s=0;s<SECTION_COUNT;s++){
+        const SectionRef &r = h.sections[s];
+        bool present = s == COORDS ? r.bytes != 0 : s < RANK || hasCh;
+        if(!present){
+            if(r.bytes) return Graph();
+            continue;
+        }
+        if(r.bytes != expected[s] || r.offset % ALIGN != 0 || r.offset > file->size() || r.bytes > file->size() - r.offset) return Graph();
+    }
+
+    FlatArray<int> offsets = view<int>(file, h.sections[OFFSETS]);
+    if(offsets[0] != 0 || offsets[n] != h.arcs) return Graph();
+
+    Graph g;
+    g.n = (int)n;
+    g.adj.clear(); // rebuilt by addEdge on demand
+    g.csr = std::make_shared<const CsrGraph>(g.n, offsets, view<int>(file, h.sections[TARGETS]), view<int>(file, h.sections[WEIGHTS]));
+    if(h.sections[COORDS].bytes) g.coords = view<NodeCoord>(file, h.sections[COORDS]);
+    if(hasCh){
+        FlatArray<int> upOffset = view<int>(file, h.sections[UP_OFFSET]);
+        if(upOffset[0] != 0 || upOffset[n] != h.upArcs) return Graph();
+        g.ch = std::make_shared<const ContractionHierarchy>(g.n, (size_t)h.shortcuts, view<int>(file, h.sections[RANK]), upOffset,
+                                                            view<int>(file, h.sections[UP_TARGET]), view<long long>(file, h.sections[UP_WEIGHT]));
+    }
+    return g;
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include "Graph.h"
+
+// Binary road-network file that is mapped and used in place: the CSR arrays,
+// optional node coordinates and optional contraction hierarchy are stored as
+// 64-byte aligned sections, so loading is an mmap plus header checks and the
+// returned Graph borrows its arrays straight from the mapping.
+//
+//   header | offsets | targets | weights | coords | rank | upOffset | upTarget | upWeight
+//
+// Files are native-endian and carry no checksum; section bounds are validated
+// on map, array contents are trusted (they come from write()). Each node's
+// upward hierarchy edges are stored sorted by target; files of an older format
+// version are rejected with an error and have to be converted again.
+namespace GraphFile {
+
+// freezes a copy of g if needed; writes the hierarchy when g has one. False on I/O error.
+bool write(const Graph &g, const std::string &path);
+
+// zero-copy load; returns an empty Graph (n == 0) if the file is missing or malformed.
+// The graph starts frozen (and preprocessed if the file has a hierarchy); adding
+// edges rebuilds adjacency lists and drops the mapped arrays as usual.
+Graph map(const std::string &path);
+
+}
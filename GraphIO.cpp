@@ -0,0 +1,87 @@
+#include "GraphIO.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <tuple>
+
+namespace GraphIO {
+
+Graph loadEdgeList(const std::string &path){
+    std::ifstream in(path);
+    if(!in) return Graph();
+    std::vector<std::tuple<int,int,int>> edges;
+    std::vector<std::tuple<int,float,float>> points;
+    int n = -1, maxId = -1;
+    std::string line;
+    while(std::getline(in, line)){
+        if(line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        if(line[0] == 'v'){
+            char tag;
+            int id;
+            float lat, lon;
+            if(ss >> tag >> id >> lat >> lon && id >= 0) points.emplace_back(id, lat, lon);
+            continue;
+        }
+        long long a, b, w;
+        if(!(ss >> a)) continue;
+        if(!(ss >> b)){
+            if(n < 0 && edges.empty()) n = (int)a; // header line
+            continue;
+        }
+        if(!(ss >> w)) w = 1;
+        if(a < 0 || b < 0) continue;
+        edges.emplace_back((int)a, (int)b, (int)w);
+        maxId = std::max(maxId, (int)std::max(a, b));
+    }
+    Graph g(n >= 0 ? n : maxId + 1);
+    for(auto &[u,v,w]: edges) g.addEdge(u, v, w);
+    if(!points.empty()){
+        std::vector<NodeCoord> c(g.n, NodeCoord{0, 0});
+        for(auto &[id,lat,lon]: points) if(id < g.n) c[id] = {lat, lon};
+        g.coords = std::move(c);
+    }
+    return g;
+}
+
+Graph loadDimacs(const std::string &path){
+    std::ifstream in(path);
+    if(!in) return Graph();
+    Graph g;
+    std::string line;
+    while(std::getline(in, line)){
+        if(line.empty()) continue;
+        std::istringstream ss(line);
+        char kind;
+        ss >> kind;
+        if(kind == 'p'){
+            std::string fmt;
+            int n = 0, m = 0;
+            ss >> fmt >> n >> m;
+            g = Graph(n);
+            for(auto &a: g.adj) a.reserve(2 * (size_t)m / std::max(1, n) + 1);
+        } else if(kind == 'a'){
+            int u, v, w;
+            if(ss >> u >> v >> w) g.addEdge(u - 1, v - 1, w);
+        }
+    }
+    return g;
+}
+
+bool loadDimacsCoordinates(Graph &g, const std::string &path){
+    std::ifstream in(path);
+    if(!in) return false;
+    std::vector<NodeCoord> c(g.n, NodeCoord{0, 0});
+    std::string line;
+    while(std::getline(in, line)){
+        if(line.empty() || line[0] != 'v') continue;
+        std::istringstream ss(line);
+        char kind;
+        long long id, x, y;
+        if(ss >> kind >> id >> x >> y && id >= 1 && id <= g.n) c[id - 1] = {(float)(y / 1e6), (float)(x / 1e6)};
+    }
+    g.coords = std::move(c);
+    return true;
+}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include "Graph.h"
+
+// Text road-network loaders. Both return an empty Graph (n == 0) on failure.
+namespace GraphIO {
+
+// Plain edge list: optional first line "n", then "u v w" per line (0-based ids);
+// without the header the node count is max id + 1. '#' starts a comment.
+// Optional "v id lat lon" lines give node coordinates.
+Graph loadEdgeList(const std::string &path);
+
+// DIMACS shortest-path format: "p sp n m", then "a u v w" arcs with 1-based ids.
+// Each arc becomes an undirected edge; road files list both directions, which
+// leaves parallel edges that searches and the contraction hierarchy tolerate.
+Graph loadDimacs(const std::string &path);
+
+// DIMACS coordinate file (.co): "v id x y" with x = longitude, y = latitude in
+// millionths of a degree. Fills g.coords; false if the file is missing.
+bool loadDimacsCoordinates(Graph &g, const std::string &path);
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <set>
+#include <numeric>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include "Graph.h"
+
+// Splits a Graph into connected cells of roughly `cellSize` nodes by growing
+// BFS regions from unassigned seeds. Cells are linked when an edge crosses
+// between them, weighted by the cheapest crossing edge. Growth leaves small
+// fragments where regions meet; intoParts() merges them away when a caller
+// needs a given number of cells rather than a given size.
+struct GraphPartition {
+    std::vector<int> cellOf;                                  // node -> cell
+    std::vector<std::vector<std::pair<int,long long>>> cellAdj; // cell -> (cell, min crossing weight)
+
+    GraphPartition() {}
+    GraphPartition(const Graph &g, int cellSize): cellOf(g.n, -1) {
+        int cells = 0;
+        std::queue<int> q;
+        for(int seed=0;seed<g.n;seed++){
+            if(cellOf[seed] != -1) continue;
+            int c = cells++, size = 0;
+            cellOf[seed] = c; q.push(seed);
+            while(!q.empty()){
+                int u = q.front(); q.pop();
+                if(++size >= cellSize) continue; // full: stop expanding, keep what is queued
+                g.forEachNeighbour(u, [&](int v, int){
+                    if(cellOf[v] == -1){ cellOf[v] = c; q.push(v); }
+                });
+            }
+        }
+        link(g, cells);
+    }
+
+    // exactly `parts` cells, unless growth produced fewer (tiny graphs). Grows
+    // cells of a quarter of the share and merges the smallest first, which keeps
+    // cells within about 0.5x..1.6x of n/parts on road-like grids.
+    static GraphPartition intoParts(const Graph &g, int parts){
+        parts = std::max(1, parts);
+        GraphPartition p(g, std::max(1, g.n / (4 * parts)));
+        p.coarsen(g, parts);
+        return p;
+    }
+
+    int cellCount() const { return (int)cellAdj.size(); }
+    int cell(int node) const { return node>=0 && node<(int)cellOf.size() ? cellOf[node] : -1; }
+
+private:
+    // merge the smallest cell into its smallest neighbour (or, when isolated,
+    // the smallest other cell) until `target` cells remain
+    void coarsen(const Graph &g, int target){
+        int cells = cellCount();
+        if(cells <= target) return;
+        std::vector<int> size(cells, 0), into(cells);
+        std::iota(into.begin(), into.end(), 0);
+        for(int c: cellOf) size[c]++;
+        std::vector<std::set<int>> adj(cells);
+        for(int c=0;c<cells;c++) for(auto &e: cellAdj[c]) adj[c].insert(e.first);
+        using Entry = std::pair<int,int>; // (size, cell)
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        for(int c=0;c<cells;c++) heap.push({size[c], c});
+        for(int left = cells; left > target; ){
+            auto [sz, c] = heap.top(); heap.pop();
+            if(into[c] != c || size[c] != sz) continue; // merged or grown since pushed
+            int to = -1;
+            for(int nb: adj[c]) if(to < 0 || size[nb] < size[to]) to = nb;
+            if(to < 0){
+                for(int o=0;o<cells;o++) if(o != c && into[o] == o && (to < 0 || size[o] < size[to])) to = o;
+            }
+            into[c] = to;
+            size[to] += size[c];
+            for(int nb: adj[c]){
+                adj[nb].erase(c);
+                if(nb != to){ adj[nb].insert(to); adj[to].insert(nb); }
+            }
+            adj[c].clear();
+            heap.push({size[to], to});
+            left--;
+        }
+        std::vector<int> id(cells, -1);
+        int next = 0;
+        for(int c=0;c<cells;c++) if(into[c] == c) id[c] = next++;
+        for(int &c: cellOf){
+            while(into[c] != c) c = into[c];
+            c = id[c];
+        }
+        link(g, next);
+    }
+
+    void link(const Graph &g, int cells){
+        cellAdj.assign(cells, {});
+        for(int u=0;u<g.n;u++){
+            g.forEachNeighbour(u, [&](int v, int w){
+                int a = cellOf[u], b = cellOf[v];
+                if(a == b) return;
+                auto &lst = cellAdj[a];
+                auto it = std::find_if(lst.begin(), lst.end(), [b](const std::pair<int,long long> &x){ return x.first == b; });
+                if(it == lst.end()) lst.push_back({b, w});
+                else it->second = std::min<long long>(it->second, w);
+            });
+        }
+    }
+};
@@ -0,0 +1,206 @@
+#include "LiveGraph.h"
+#include "ContractionHierarchy.h"
+#include "DistanceCache.h"
+#include "../utils/Logger.h"
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+// most queued updates applied by one publish(); the rest wait for the next
+static const size_t MAX_BATCH = 1 << 16;
+
+LiveGraph::LiveGraph(Graph g, LiveGraphConfig c): cfg(c) {
+    g.freeze();
+    if(cfg.exact){
+        g.ch = std::make_shared<const ContractionHierarchy>(g, ContractionHierarchy::dissectionOrder(g));
+        // searches differ between hierarchies, so stop sharing g's cache
+        if(g.cache) g.cache = std::make_shared<DistanceCache>(g.cache->capacity());
+    } else {
+        g.preprocess();
+    }
+    g.adj.clear(); // versions read the CSR arrays only
+    g.adj.shrink_to_fit();
+    weights = g.csr->weights.toVector();
+    weightsDirty.assign(g.csr->weights.chunkCount(), 0);
+    install(g.ch);
+    g.ch = ch;
+    current = std::make_shared<const Graph>(std::move(g));
+
+    publisher.start(cfg.publishInterval, [this]{ publish(); });
+    if(!cfg.exact) rebuilder.start(cfg.rebuildInterval, [this]{ rebuild(); });
+}
+
+LiveGraph::~LiveGraph(){
+    publisher.stop();
+    rebuilder.stop();
+}
+
+void LiveGraph::updateWeight(int u, int v, int weight){ inbox.push({u, v, weight}); }
+
+// index the hierarchy's upward edges by their head so repairs can find lower triangles; caller holds mtx
+void LiveGraph::install(std::shared_ptr<const ContractionHierarchy> h){
+    ch = std::move(h);
+    const int n = ch->nodeCount();
+    const auto &off = ch->upOffsets();
+    const auto &tgt = ch->upTargets();
+    upPublished = ch->upWeights();
+    upWeight = upPublished.toVector();
+    upDirty.assign(upPublished.chunkCount(), 0);
+    queued.assign(upWeight.size(), 0);
+    nodeQueued.assign(n, 0);
+    downOffset.assign(n + 1, 0);
+    for(size_t k=0;k<tgt.size();k++) downOffset[tgt[k] + 1]++;
+    for(int a=0;a<n;a++) downOffset[a+1] += downOffset[a];
+    downFrom.resize(tgt.size());
+    downEdge.resize(tgt.size());
+    std::vector<int> fill(downOffset.begin(), downOffset.end() - 1);
+    for(int z=0;z<n;z++){ // ascending z keeps every list sorted, for the triangle merge in repair()
+        for(int k=off[z];k<off[z+1];k++){
+            int p = fill[tgt[k]]++;
+            downFrom[p] = z;
+            downEdge[p] = k;
+        }
+    }
+}
+
+int LiveGraph::upEdge(int x, int y) const {
+    const auto &off = ch->upOffsets();
+    const auto &tgt = ch->upTargets();
+    const int *b = tgt.data() + off[x], *e = tgt.data() + off[x+1];
+    const int *it = std::lower_bound(b, e, y); // upward lists are sorted by target
+    return it != e && *it == y ? (int)(it - tgt.data()) : -1;
+}
+
+// lightest road between x and y in the next version's weights (INF if none)
+long long LiveGraph::baseWeight(int x, int y) const {
+    const CsrGraph &csr = *current->csr;
+    long long best = Graph::INF;
+    for(int k=csr.offsets[x];k<csr.offsets[x+1];k++){
+        if(csr.targets[k] == y) best = std::min<long long>(best, weights[k]);
+    }
+    return best;
+}
+
+// Recompute the upward edges affected by the changed roads. An edge x -> y weighs
+// min(road x-y, min over z below both of w(z->x) + w(z->y)), so edges are settled
+// in increasing rank of their lower end: every triangle they read is final by then,
+// and a changed edge only feeds edges whose lower end ranks higher.
+void LiveGraph::repair(const std::vector<std::pair<int,int>>& changed){
+    const auto &rank = ch->ranks();
+    const auto &off = ch->upOffsets();
+    const auto &tgt = ch->upTargets();
+    // queued nodes by rank; their dirty upward edges are flagged in `queued`
+    using Q = std::pair<int,int>; // rank, node
+    std::priority_queue<Q, std::vector<Q>, std::greater<Q>> pq;
+    auto enqueue = [&](int a, int b){
+        if(rank[a] > rank[b]) std::swap(a, b);
+        int k = upEdge(a, b);
+        if(k < 0 || queued[k]) return;
+        queued[k] = 1;
+        if(!nodeQueued[a]){ nodeQueued[a] = 1; pq.push({rank[a], a}); }
+    };
+    for(auto &e: changed) enqueue(e.first, e.second);
+
+    uint64_t count = 0;
+    while(!pq.empty()){
+        int x = pq.top().second; pq.pop();
+        nodeQueued[x] = 0;
+        for(int k=off[x];k<off[x+1];k++){
+            if(!queued[k]) continue;
+            queued[k] = 0;
+            int y = tgt[k];
+            long long w = baseWeight(x, y);
+            // lower triangles: nodes z with edges into both x and y; both lists are sorted by z
+            int p = downOffset[x], q = downOffset[y];
+            while(p < downOffset[x+1] && q < downOffset[y+1]){
+                if(downFrom[p] < downFrom[q]) p++;
+                else if(downFrom[p] > downFrom[q]) q++;
+                else { w = std::min(w, upWeight[downEdge[p]] + upWeight[downEdge[q]]); p++; q++; }
+            }
+            if(w == upWeight[k]) continue;
+            upWeight[k] = w;
+            upDirty[k >> ChunkedArray<long long>::CHUNK_BITS] = 1;
+            count++;
+            for(int k2=off[x];k2<off[x+1];k2++) if(k2 != k) enqueue(y, tgt[k2]);
+        }
+    }
+    repaired += count;
+}
+
+// build the next version from prev plus the writer-side weights, copying only
+// dirty chunks; caller holds mtx
+void LiveGraph::publishVersion(const Graph &prev){
+    ChunkedArray<int> w = prev.csr->weights;
+    for(size_t c=0;c<weightsDirty.size();c++){
+        if(weightsDirty[c]){ w.replaceChunk(c, weights.data()); weightsDirty[c] = 0; }
+    }
+    for(size_t c=0;c<upDirty.size();c++){
+        if(upDirty[c]){ upPublished.replaceChunk(c, upWeight.data()); upDirty[c] = 0; }
+    }
+    auto next = std::make_shared<Graph>();
+    next->n = prev.n;
+    next->coords = prev.coords;
+    next->version = prev.version + 1;
+    next->cache = prev.cache; // entries are keyed by version, the old ones age out
+    next->csr = std::make_shared<const CsrGraph>(prev.n, prev.csr->offsets, prev.csr->targets, std::move(w));
+    next->ch = std::make_shared<const ContractionHierarchy>(ch->nodeCount(), ch->shortcutCount(), ch->ranks(),
+                                                            ch->upOffsets(), ch->upTargets(), upPublished);
+    std::atomic_store(&current, std::shared_ptr<const Graph>(std::move(next)));
+}
+
+bool LiveGraph::publish(){
+    std::lock_guard<std::mutex> lg(mtx);
+    auto prev = std::atomic_load(&current);
+    const CsrGraph &csr = *prev->csr;
+    std::vector<std::pair<int,int>> changed;
+    // bounded so a steady update stream cannot keep one publish draining forever
+    for(size_t taken=0;taken<MAX_BATCH;taken++){
+        auto e = inbox.pop();
+        if(!e) break;
+        if(e->u < 0 || e->v < 0 || e->u >= prev->n || e->v >= prev->n || e->weight < 0) continue;
+        bool any = false;
+        auto set = [&](int a, int b){
+            for(int k=csr.offsets[a];k<csr.offsets[a+1];k++){
+                if(csr.targets[k] == b && weights[k] != e->weight){
+                    weights[k] = e->weight;
+                    weightsDirty[k >> ChunkedArray<int>::CHUNK_BITS] = 1;
+                    any = true;
+                }
+            }
+        };
+        set(e->u, e->v);
+        set(e->v, e->u);
+        if(any) changed.push_back({e->u, e->v});
+    }
+    if(changed.empty()) return false;
+    repair(changed);
+    publishVersion(*prev);
+    LOG_DEBUG("Graph version {}: {} roads updated", prev->version + 1, changed.size());
+    return true;
+}
+
+void LiveGraph::rebuild(){
+    if(cfg.exact) return; // repairs are already exact
+    auto base = snapshot();
+    Graph g; // contract the base weights with no lock held; publishing continues meanwhile
+    g.n = base->n;
+    g.adj.clear();
+    g.csr = base->csr;
+    auto fresh = std::make_shared<const ContractionHierarchy>(g);
+
+    std::lock_guard<std::mutex> lg(mtx);
+    auto prev = std::atomic_load(&current);
+    // roads updated while contracting are repaired onto the new hierarchy
+    std::vector<std::pair<int,int>> changed;
+    const CsrGraph &csr = *prev->csr;
+    for(int u=0;u<csr.n;u++){
+        for(int k=csr.offsets[u];k<csr.offsets[u+1];k++){
+            if(weights[k] != base->csr->weights[k] && u < csr.targets[k]) changed.push_back({u, csr.targets[k]});
+        }
+    }
+    install(fresh);
+    repair(changed);
+    publishVersion(*prev);
+    LOG_INFO("Graph version {}: hierarchy rebuilt, {} shortcuts, {} roads changed meanwhile", prev->version + 1,
+             fresh->shortcutCount(), changed.size());
+}
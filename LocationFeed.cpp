@@ -0,0 +1,98 @@
+#include "LocationFeed.h"
+#include "../utils/Logger.h"
+
+LocationFeed::LocationFeed(const Graph &g): locator(g) {
+    for(auto &s: shards) s = std::make_shared<const Shard>();
+    if(locator.empty()) LOG_WARN("LocationFeed: graph has no coordinates, pings cannot be snapped");
+}
+
+void LocationFeed::trackLocked(const std::shared_ptr<Driver> &drv, std::array<std::shared_ptr<Shard>, SHARDS> &copies){
+    int s = shardOf(drv->id);
+    if(!copies[s]) copies[s] = std::make_shared<Shard>(*std::atomic_load(&shards[s]));
+    auto slot = std::make_shared<Slot>();
+    slot->driver = drv;
+    auto &cur = (*copies[s])[drv->id];
+    if(cur) cur->removed.store(true); // a replaced driver object keeps no queued move
+    cur = std::move(slot);
+}
+
+void LocationFeed::track(const std::shared_ptr<Driver> &drv){
+    track(std::vector<std::shared_ptr<Driver>>{drv});
+}
+
+void LocationFeed::track(const std::vector<std::shared_ptr<Driver>> &drvs){
+    std::lock_guard<std::mutex> lg(writeMtx);
+    std::array<std::shared_ptr<Shard>, SHARDS> copies; // each touched shard is copied once
+    for(auto &d: drvs) if(d) trackLocked(d, copies);
+    for(int s=0;s<SHARDS;s++)
+        if(copies[s]) std::atomic_store(&shards[s], std::shared_ptr<const Shard>(std::move(copies[s])));
+}
+
+void LocationFeed::untrack(int driverId){
+    std::lock_guard<std::mutex> lg(writeMtx);
+    int s = shardOf(driverId);
+    auto cur = std::atomic_load(&shards[s]);
+    auto it = cur->find(driverId);
+    if(it == cur->end()) return;
+    it->second->removed.store(true);
+    auto next = std::make_shared<Shard>(*cur);
+    next->erase(driverId);
+    std::atomic_store(&shards[s], std::shared_ptr<const Shard>(std::move(next)));
+}
+
+void LocationFeed::ingest(const GpsPing *batch, size_t n){
+    // one directory load per batch; counters are summed locally and published once
+    std::array<std::shared_ptr<const Shard>, SHARDS> dir;
+    for(int s=0;s<SHARDS;s++) dir[s] = std::atomic_load(&shards[s]);
+    uint64_t nStale = 0, nUnknown = 0, nOffMap = 0;
+    for(size_t i=0;i<n;i++){
+        const GpsPing &p = batch[i];
+        const Shard &shard = *dir[shardOf(p.driverId)];
+        auto it = shard.find(p.driverId);
+        if(it == shard.end()){ nUnknown++; continue; }
+        int node = locator.snap(p.lat, p.lon);
+        if(node < 0){ nOffMap++; continue; }
+        Slot &slot = *it->second;
+        uint64_t want = (uint64_t)p.time << 32 | (uint32_t)node;
+        uint64_t cur = slot.latest.load(std::memory_order_relaxed);
+        bool stored = false;
+        while(cur == EMPTY || (int32_t)(p.time - (uint32_t)(cur >> 32)) >= 0){
+            if(slot.latest.compare_exchange_weak(cur, want, std::memory_order_seq_cst, std::memory_order_relaxed)){ stored = true; break; }
+        }
+        if(!stored){ nStale++; continue; }
+        // the first ping since the last apply() queues the driver; later ones only overwrite latest.
+        // seq_cst pairs with apply(): either it sees this ping or this ping re-queues the driver.
+        if(!slot.dirty.exchange(true, std::memory_order_seq_cst)) moved.push(it->second);
+    }
+    pings.fetch_add(n, std::memory_order_relaxed);
+    if(nStale) stale.fetch_add(nStale, std::memory_order_relaxed);
+    if(nUnknown) unknown.fetch_add(nUnknown, std::memory_order_relaxed);
+    if(nOffMap) offMap.fetch_add(nOffMap, std::memory_order_relaxed);
+}
+
+int LocationFeed::apply(){
+    int count = 0;
+    while(auto s = moved.pop()){
+        Slot &slot = **s;
+        // clear before reading: a ping landing after the read re-queues the driver
+        slot.dirty.store(false, std::memory_order_seq_cst);
+        uint64_t cur = slot.latest.load(std::memory_order_seq_cst);
+        if(cur == EMPTY || slot.removed.load()) continue;
+        int node = (int)(uint32_t)cur;
+        if(slot.driver->location.load() == node) continue;
+        slot.driver->setLocation(node);
+        count++;
+    }
+    if(count) applied.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+LocationFeedStats LocationFeed::stats() const {
+    LocationFeedStats s;
+    s.pings = pings.load(std::memory_order_relaxed);
+    s.stale = stale.load(std::memory_order_relaxed);
+    s.unknown = unknown.load(std::memory_order_relaxed);
+    s.offMap = offMap.load(std::memory_order_relaxed);
+    s.moved = applied.load(std::memory_order_relaxed);
+    return s;
+}
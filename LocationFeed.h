@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Graph.h"
+#include "NodeLocator.h"
+#include "../models/Driver.h"
+#include "../utils/MpscQueue.h"
+
+// one raw position report from a driver's phone
+struct GpsPing {
+    int driverId;
+    float lat, lon;
+    uint32_t time; // sender clock in ms; wraps, compared by signed difference
+};
+
+struct LocationFeedStats {
+    uint64_t pings{0};
+    uint64_t stale{0};    // older than a ping already held for the driver
+    uint64_t unknown{0};  // driver not tracked
+    uint64_t offMap{0};   // graph has no coordinates
+    uint64_t moved{0};    // positions applied to drivers
+};
+
+// Coalesces high-rate GPS pings into driver positions. ingest() snaps each ping
+// to a node on the calling thread and keeps only the newest one per driver in
+// a single atomic word, so any number of producers run without locks and a
+// driver pinging ten times between rounds costs one move. Drivers that got a
+// ping since the last apply() are queued once; apply() moves just those, from
+// one consumer thread (the dispatcher, at the start of a round).
+class LocationFeed {
+public:
+    explicit LocationFeed(const Graph &g);
+
+    // drivers are looked up per ping; untracked drivers' pings are dropped
+    void track(const std::shared_ptr<Driver> &drv);
+    void track(const std::vector<std::shared_ptr<Driver>> &drvs);
+    void untrack(int driverId);
+
+    // lock-free, callable from any number of threads
+    void ingest(const GpsPing *pings, size_t n);
+    void ingest(const std::vector<GpsPing> &pings){ ingest(pings.data(), pings.size()); }
+
+    // move every driver with a newer ping to its snapped node; single consumer.
+    // Returns how many drivers moved.
+    int apply();
+
+    LocationFeedStats stats() const;
+
+private:
+    static constexpr uint64_t EMPTY = ~0ull;
+    struct Slot {
+        std::shared_ptr<Driver> driver;
+        std::atomic<uint64_t> latest{EMPTY}; // time << 32 | node of the newest ping
+        std::atomic<bool> dirty{false};      // queued for apply()
+        std::atomic<bool> removed{false};
+    };
+    using Shard = std::unordered_map<int, std::shared_ptr<Slot>>;
+    static constexpr int SHARDS = 64;
+
+    NodeLocator locator;
+    // copy-on-write directory: ingest() loads each shard atomically, track() replaces it
+    std::array<std::shared_ptr<const Shard>, SHARDS> shards;
+    std::mutex writeMtx; // serializes track/untrack
+    MpscQueue<std::shared_ptr<Slot>> moved;
+
+    std::atomic<uint64_t> pings{0}, stale{0}, unknown{0}, offMap{0}, applied{0};
+
+    static int shardOf(int driverId){ return (int)((unsigned)driverId % SHARDS); }
+    void trackLocked(const std::shared_ptr<Driver> &drv, std::array<std::shared_ptr<Shard>, SHARDS> &copies);
+};
@@ -0,0 +1,263 @@
+#include "Logger.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+namespace logdetail {
+
+// records per logging thread, powers of two. A thread starts with a small ring
+// (~4KB) and moves to one twice the size whenever it fills, up to ~125KB, so
+// threads that log a few lines and exit stay cheap.
+const size_t RING_MIN = 16;
+const size_t RING_MAX = 512;
+
+// single-producer (owning thread) / single-consumer (writer thread) ring
+struct Ring {
+    explicit Ring(size_t cap): slots(new Record[cap]), capacity(cap) {}
+    std::unique_ptr<Record[]> slots;
+    const size_t capacity;
+    std::atomic<size_t> head{0}; // next slot the producer fills
+    std::atomic<size_t> tail{0}; // next slot the writer reads
+    std::atomic<bool> orphaned{false}; // owning thread exited or moved to a larger ring
+
+    Record& at(size_t i){ return slots[i & (capacity-1)]; }
+};
+
+struct Backend {
+    std::mutex regMtx; // ring registration and synchronous fallback writes only
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::thread writer;
+    std::atomic<bool> running{false};
+    std::atomic<bool> stopped{false};
+    std::atomic<FILE*> out{stdout};
+    std::atomic<LogOverflow> overflow{LogOverflow::DROP};
+    std::atomic<unsigned long long> drops{0};
+    std::string buf;
+
+    // the writer parks on wakeCv when every ring is empty; a producer whose
+    // commit finds it parked wakes it. doneCv tells flush() a batch is out.
+    std::mutex wakeMtx;
+    std::condition_variable wakeCv;
+    std::atomic<bool> parked{false};
+    std::condition_variable doneCv;
+
+    Backend(){
+        running.store(true);
+        writer = std::thread([this]{ run(); });
+        std::atexit([]{ instance().shutdown(); });
+    }
+
+    static Backend& instance(){
+        // never destroyed: threads may still log while statics are torn down
+        static Backend *b = new Backend;
+        return *b;
+    }
+
+    void run(){
+        std::vector<std::pair<uint64_t, const Record*>> batch;
+        while(true){
+            bool stop = !running.load();
+            if(drainOnce(batch) > 0) continue;
+            if(stop) break;
+            std::unique_lock<std::mutex> lk(wakeMtx);
+            // announce first, then look: a commit either sees parked or is seen here
+            parked.store(true);
+            if(running.load() && !anyPublished()) wakeCv.wait(lk, [this]{ return !parked.load(); });
+            parked.store(false);
+        }
+        std::lock_guard<std::mutex> lg(wakeMtx);
+        doneCv.notify_all(); // flush() callers see stopped
+    }
+
+    void wake(){
+        std::lock_guard<std::mutex> lg(wakeMtx);
+        parked.store(false);
+        wakeCv.notify_one();
+    }
+
+    bool anyPublished(){
+        std::lock_guard<std::mutex> lg(regMtx);
+        for(auto &r: rings){
+            if(r->head.load() != r->tail.load(std::memory_order_relaxed)) return true;
+        }
+        return false;
+    }
+
+    // format and write everything currently published, oldest first across threads
+    size_t drainOnce(std::vector<std::pair<uint64_t, const Record*>> &batch){
+        std::vector<std::pair<Ring*, size_t>> ends;
+        {
+            std::lock_guard<std::mutex> lg(regMtx);
+            batch.clear();
+            for(auto &r: rings){
+                size_t t = r->tail.load(std::memory_order_relaxed);
+                size_t h = r->head.load(std::memory_order_acquire);
+                for(size_t i=t;i<h;i++) batch.push_back({r->at(i).ts, &r->at(i)});
+                ends.push_back({r.get(), h});
+            }
+        }
+        if(batch.empty()){
+            reapOrphans();
+            return 0;
+        }
+        std::stable_sort(batch.begin(), batch.end(), [](const auto &a, const auto &b){ return a.first < b.first; });
+        buf.clear();
+        for(auto &e: batch) format(*e.second, buf);
+        FILE *f = out.load();
+        std::fwrite(buf.data(), 1, buf.size(), f);
+        std::fflush(f);
+        {
+            std::lock_guard<std::mutex> lg(wakeMtx);
+            for(auto &e: ends) e.first->tail.store(e.second, std::memory_order_release);
+        }
+        doneCv.notify_all();
+        return batch.size();
+    }
+
+    void reapOrphans(){
+        std::lock_guard<std::mutex> lg(regMtx);
+        rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<Ring> &r){
+            return r->orphaned.load() && r->tail.load() == r->head.load();
+        }), rings.end());
+    }
+
+    static const char* levelName(LogLevel l){
+        switch(l){
+        case LogLevel::DEBUG: return "[DEBUG] ";
+        case LogLevel::INFO: return "[INFO] ";
+        case LogLevel::WARN: return "[WARN] ";
+        case LogLevel::ERROR: return "[ERROR] ";
+        default: return "";
+        }
+    }
+
+    static void format(const Record &r, std::string &o){
+        o += levelName(r.level);
+        int next = 0;
+        for(const char *p = r.fmt; *p; p++){
+            if(p[0] == '{' && p[1] == '}' && next < r.nargs){
+                const Arg &a = r.args[next++];
+                switch(a.type){
+                case ArgType::I64: o += std::to_string(a.i); break;
+                case ArgType::U64: o += std::to_string(a.u); break;
+                case ArgType::F64: o += std::to_string(a.d); break;
+                case ArgType::STR: o.append(r.text + a.s.off, a.s.len); break;
+                }
+                p++;
+            } else {
+                o += *p;
+            }
+        }
+        o += '\n';
+    }
+
+    void shutdown(){
+        if(stopped.exchange(true)) return;
+        running.store(false);
+        wake();
+        if(writer.joinable()) writer.join();
+    }
+};
+
+struct LocalRing {
+    std::shared_ptr<Ring> ring;
+    Record direct;       // used once the writer has shut down
+    bool usingDirect{false};
+    LocalRing(){ attach(RING_MIN); }
+    ~LocalRing(){ ring->orphaned.store(true); }
+
+    // switch to a new ring; the writer drains the old one and then drops it
+    void attach(size_t capacity){
+        auto next = std::make_shared<Ring>(capacity);
+        auto &b = Backend::instance();
+        std::lock_guard<std::mutex> lg(b.regMtx);
+        if(ring) ring->orphaned.store(true);
+        ring = next;
+        b.rings.push_back(ring);
+    }
+};
+
+static LocalRing& localRing(){
+    thread_local LocalRing local;
+    return local;
+}
+
+Record* claim(){
+    LocalRing &local = localRing();
+    auto &b = Backend::instance();
+    if(b.stopped.load(std::memory_order_relaxed)){
+        local.usingDirect = true;
+        return &local.direct;
+    }
+    Ring *r = local.ring.get();
+    size_t h = r->head.load(std::memory_order_relaxed);
+    while(h - r->tail.load(std::memory_order_acquire) >= r->capacity){
+        if(r->capacity < RING_MAX){
+            // records in the old ring are already published and keep their timestamps
+            local.attach(r->capacity * 2);
+            r = local.ring.get();
+            h = 0;
+            break;
+        }
+        if(b.overflow.load(std::memory_order_relaxed) == LogOverflow::DROP || b.stopped.load()){
+            b.drops.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        std::this_thread::yield(); // BLOCK: wait for the writer to make room
+    }
+    Record *rec = &r->at(h);
+    rec->ts = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    return rec;
+}
+
+void commit(){
+    LocalRing &local = localRing();
+    if(local.usingDirect){
+        // writer already shut down (process exit): format and write synchronously
+        local.usingDirect = false;
+        auto &b = Backend::instance();
+        std::string s;
+        Backend::format(local.direct, s);
+        std::lock_guard<std::mutex> lg(b.regMtx);
+        std::fwrite(s.data(), 1, s.size(), b.out.load());
+        std::fflush(b.out.load());
+        return;
+    }
+    Ring &r = *local.ring;
+    // seq_cst store paired with the writer's parked flag, so a wakeup is never lost
+    r.head.store(r.head.load(std::memory_order_relaxed) + 1);
+    auto &b = Backend::instance();
+    if(b.parked.load()) b.wake();
+}
+
+} // namespace logdetail
+
+using namespace logdetail;
+
+void Logger::setOverflowPolicy(LogOverflow p){ Backend::instance().overflow.store(p); }
+
+void Logger::setOutput(FILE *f){ Backend::instance().out.store(f ? f : stdout); }
+
+unsigned long long Logger::dropped(){ return Backend::instance().drops.load(); }
+
+void Logger::flush(){
+    auto &b = Backend::instance();
+    std::vector<std::pair<std::shared_ptr<Ring>, size_t>> marks;
+    {
+        std::lock_guard<std::mutex> lg(b.regMtx);
+        for(auto &r: b.rings) marks.push_back({r, r->head.load(std::memory_order_acquire)});
+    }
+    std::unique_lock<std::mutex> lk(b.wakeMtx);
+    b.doneCv.wait(lk, [&]{
+        if(b.stopped.load()) return true;
+        for(auto &m: marks){
+            if(m.first->tail.load(std::memory_order_acquire) < m.second) return false;
+        }
+        return true;
+    });
+}
@@ -1,13 +1,120 @@
 #pragma once
-#include <mutex>
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <type_traits>
+
+// Asynchronous logger. Call sites hand over a format string literal with "{}"
+// placeholders and typed arguments; they are copied into a fixed-size record
+// in the calling thread's lock-free ring buffer and formatted later by a
+// background writer thread that writes in batches.
+//
+//   LOG_INFO("Assigned Order {} -> Driver {}", orderId, driverId);
+//
+// Levels below LOG_MIN_LEVEL compile to nothing (arguments are not evaluated).
+
+enum class LogLevel : uint8_t { DEBUG = 0, INFO = 1, WARN = 2, ERROR = 3, OFF = 4 };
+
+// what a producer does when its ring buffer is full
+enum class LogOverflow : uint8_t { DROP, BLOCK };
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1 // INFO
+#endif
+
+#define LOG_AT(lvl, ...) do { if(LOG_MIN_LEVEL <= (int)(lvl)) Logger::log((lvl), __VA_ARGS__); } while(0)
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+
+namespace logdetail {
+
+const int MAX_ARGS = 6;
+const int TEXT_CAP = 128; // bytes shared by all string arguments of one record
+
+enum class ArgType : uint8_t { I64, U64, F64, STR };
+
+struct Arg {
+    ArgType type;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        struct { uint16_t off, len; } s;
+    };
+};
+
+struct Record {
+    uint64_t ts;          // steady clock nanoseconds, orders records across threads
+    const char *fmt;      // must be a string literal
+    LogLevel level;
+    uint8_t nargs;
+    uint16_t textLen;
+    Arg args[MAX_ARGS];
+    char text[TEXT_CAP];
+
+    void addText(const char *p, size_t n){
+        Arg &a = args[nargs++];
+        a.type = ArgType::STR;
+        n = std::min<size_t>(n, TEXT_CAP - textLen); // truncate rather than spill
+        std::memcpy(text + textLen, p, n);
+        a.s.off = textLen;
+        a.s.len = (uint16_t)n;
+        textLen += (uint16_t)n;
+    }
+};
+
+template<typename T>
+inline void capture(Record &r, const T &v){
+    if constexpr (std::is_same_v<T, bool>){
+        r.addText(v ? "true" : "false", v ? 4 : 5);
+    } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>){
+        Arg &a = r.args[r.nargs++];
+        if constexpr (std::is_signed_v<T> || std::is_enum_v<T>){ a.type = ArgType::I64; a.i = (long long)v; }
+        else { a.type = ArgType::U64; a.u = (unsigned long long)v; }
+    } else if constexpr (std::is_floating_point_v<T>){
+        Arg &a = r.args[r.nargs++];
+        a.type = ArgType::F64; a.d = (double)v;
+    } else {
+        std::string_view sv(v);
+        r.addText(sv.data(), sv.size());
+    }
+}
+
+// claim a record in this thread's ring (nullptr when dropped), then publish it
+Record* claim();
+void commit();
+
+} // namespace logdetail
 
 struct Logger {
-    static std::mutex m;
-    static void info(const std::string &s){
-        std::lock_guard<std::mutex> lg(m);
-        std::cout << "[INFO] " << s << std::endl;
+    template<typename... Args>
+    static void log(LogLevel lvl, const char *fmt, const Args&... args){
+        static_assert(sizeof...(Args) <= logdetail::MAX_ARGS, "too many log arguments");
+        if((uint8_t)lvl < runtimeLevel.load(std::memory_order_relaxed)) return;
+        logdetail::Record *r = logdetail::claim();
+        if(!r) return;
+        r->fmt = fmt;
+        r->level = lvl;
+        r->nargs = 0;
+        r->textLen = 0;
+        (logdetail::capture(*r, args), ...);
+        logdetail::commit();
     }
+
+    // pre-formatted message; prefer LOG_INFO with arguments on hot paths
+    static void info(const std::string &s){ log(LogLevel::INFO, "{}", s); }
+
+    static void setLevel(LogLevel lvl){ runtimeLevel.store((uint8_t)lvl); }
+    static void setOverflowPolicy(LogOverflow p);
+    static void setOutput(FILE *f);            // default stdout
+    static void flush();                       // wait until everything logged so far is written
+    static unsigned long long dropped();       // records lost to a full ring (DROP policy)
+
+    static inline std::atomic<uint8_t> runtimeLevel{(uint8_t)LogLevel::INFO};
 };
-std::mutex Logger::m;
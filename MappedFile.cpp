@@ -0,0 +1,25 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string &path){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0){
+        ::close(fd);
+        return nullptr;
+    }
+    size_t len = (size_t)st.st_size;
+    void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference to the file
+    if(p == MAP_FAILED) return nullptr;
+    madvise(p, len, MADV_WILLNEED); // start readahead now; pages still fault in lazily
+    return std::shared_ptr<const MappedFile>(new MappedFile((const char*)p, len));
+}
+
+MappedFile::~MappedFile(){
+    munmap((void*)base, length);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Read-only memory mapping of a whole file, unmapped when the last owner goes away.
+class MappedFile {
+public:
+    // nullptr if the file cannot be opened or mapped
+    static std::shared_ptr<const MappedFile> open(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    MappedFile(const char *b, size_t len): base(b), length(len) {}
+    const char *base;
+    size_t length;
+};
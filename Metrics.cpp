@@ -0,0 +1,238 @@
+#include "Metrics.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace metricsdetail {
+
+const size_t NC = (size_t)Counter::COUNT;
+const size_t NH = (size_t)Histogram::COUNT;
+
+struct HistShard {
+    std::atomic<uint64_t> count{0}, sum{0}, max{0};
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+};
+
+// written only by its owning thread; read concurrently by snapshot()
+struct Shard {
+    std::atomic<uint64_t> counters[NC] = {};
+    HistShard hist[NH];
+};
+
+// single writer, so a relaxed load + store is enough (no locked RMW on the hot path)
+static inline void bump(std::atomic<uint64_t> &a, uint64_t n){
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void add(Shard &s, Counter c, uint64_t n){ bump(s.counters[(size_t)c], n); }
+
+void record(Shard &s, Histogram h, uint64_t v){
+    HistShard &hs = s.hist[(size_t)h];
+    bump(hs.count, 1);
+    bump(hs.sum, v);
+    if(v > hs.max.load(std::memory_order_relaxed)) hs.max.store(v, std::memory_order_relaxed);
+    bump(hs.buckets[bucketOf(v)], 1);
+}
+
+struct Registry {
+    std::mutex mtx;
+    std::vector<std::shared_ptr<Shard>> live;
+    MetricsSnapshot retired; // totals of shards whose threads have exited
+    std::chrono::steady_clock::time_point started{std::chrono::steady_clock::now()};
+
+    std::thread dumper;
+    std::condition_variable cv;
+    bool dumping{false};
+
+    static Registry& instance(){
+        // never destroyed: threads may still record while statics are torn down
+        static Registry *r = new Registry;
+        return *r;
+    }
+};
+
+static void mergeShard(const Shard &s, MetricsSnapshot &out){
+    for(size_t c=0;c<NC;c++) out.counters[c] += s.counters[c].load(std::memory_order_relaxed);
+    for(size_t h=0;h<NH;h++){
+        const HistShard &hs = s.hist[h];
+        HistogramSnapshot &o = out.histograms[h];
+        o.count += hs.count.load(std::memory_order_relaxed);
+        o.sum += hs.sum.load(std::memory_order_relaxed);
+        o.max = std::max(o.max, hs.max.load(std::memory_order_relaxed));
+        for(int b=0;b<BUCKETS;b++) o.buckets[b] += hs.buckets[b].load(std::memory_order_relaxed);
+    }
+}
+
+struct LocalShard {
+    std::shared_ptr<Shard> shard;
+    LocalShard(){
+        shard = std::make_shared<Shard>();
+        auto &r = Registry::instance();
+        std::lock_guard<std::mutex> lg(r.mtx);
+        r.live.push_back(shard);
+    }
+    ~LocalShard(){
+        auto &r = Registry::instance();
+        std::lock_guard<std::mutex> lg(r.mtx);
+        mergeShard(*shard, r.retired);
+        r.live.erase(std::remove(r.live.begin(), r.live.end(), shard), r.live.end());
+    }
+};
+
+Shard& localShard(){
+    thread_local LocalShard local;
+    return *local.shard;
+}
+
+} // namespace metricsdetail
+
+using namespace metricsdetail;
+
+uint64_t HistogramSnapshot::quantile(double q) const {
+    if(count == 0) return 0;
+    uint64_t rank = (uint64_t)std::max(1.0, q * (double)count + 0.5);
+    uint64_t seen = 0;
+    for(int b=0;b<BUCKETS;b++){
+        seen += buckets[b];
+        if(seen >= rank) return std::min(bucketUpper(b), max);
+    }
+    return max;
+}
+
+double MetricsSnapshot::driverUtilization() const {
+    long long registered = gauge(Gauge::DRIVERS_REGISTERED);
+    if(registered <= 0) return 0.0;
+    return std::min(1.0, (double)gauge(Gauge::DRIVERS_BUSY) / registered);
+}
+
+MetricsSnapshot Metrics::snapshot(){
+    auto &r = Registry::instance();
+    MetricsSnapshot s;
+    {
+        std::lock_guard<std::mutex> lg(r.mtx);
+        s = r.retired;
+        for(auto &sh: r.live) mergeShard(*sh, s);
+        s.uptimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.started).count();
+    }
+    for(size_t g=0;g<(size_t)Gauge::COUNT;g++) s.gauges[g] = gauges[g].load(std::memory_order_relaxed);
+    return s;
+}
+
+static const char* counterName(Counter c){
+    switch(c){
+    case Counter::ORDERS_SUBMITTED: return "dispatch_orders_submitted_total";
+    case Counter::ORDERS_CANCELLED: return "dispatch_orders_cancelled_total";
+    case Counter::ORDERS_REJECTED: return "dispatch_orders_rejected_total";
+    case Counter::ASSIGNMENTS: return "dispatch_assignments_total";
+    case Counter::DISPATCH_ROUNDS: return "dispatch_rounds_total";
+    case Counter::DRIVER_BUSY_NS: return "dispatch_driver_busy_nanoseconds_total";
+    case Counter::DISTANCE_CACHE_HITS: return "dispatch_distance_cache_hits_total";
+    case Counter::DISTANCE_CACHE_MISSES: return "dispatch_distance_cache_misses_total";
+    case Counter::ORDERS_STOLEN: return "dispatch_orders_stolen_total";
+    case Counter::RELOCATIONS: return "dispatch_relocations_total";
+    default: return "unknown";
+    }
+}
+
+static const char* histogramName(Histogram h){
+    switch(h){
+    case Histogram::QUEUE_WAIT_NS: return "dispatch_queue_wait_nanoseconds";
+    case Histogram::DISPATCH_LOCK_HOLD_NS: return "dispatch_lock_hold_nanoseconds";
+    case Histogram::ASSIGN_NS: return "dispatch_assign_nanoseconds";
+    case Histogram::SHORTEST_PATH_NS: return "dispatch_shortest_path_nanoseconds";
+    case Histogram::ASSIGNMENTS_PER_ROUND: return "dispatch_assignments_per_round";
+    default: return "unknown";
+    }
+}
+
+static const char* gaugeName(Gauge g){
+    switch(g){
+    case Gauge::DRIVERS_REGISTERED: return "dispatch_drivers_registered";
+    case Gauge::DRIVERS_BUSY: return "dispatch_drivers_busy";
+    case Gauge::ORDERS_QUEUED: return "dispatch_orders_queued";
+    default: return "unknown";
+    }
+}
+
+std::string MetricsSnapshot::toPrometheus() const {
+    std::string o;
+    char line[160];
+    for(size_t c=0;c<counters.size();c++){
+        const char *name = counterName((Counter)c);
+        std::snprintf(line, sizeof line, "# TYPE %s counter\n%s %llu\n", name, name, (unsigned long long)counters[c]);
+        o += line;
+    }
+    for(size_t g=0;g<gauges.size();g++){
+        const char *name = gaugeName((Gauge)g);
+        std::snprintf(line, sizeof line, "# TYPE %s gauge\n%s %lld\n", name, name, gauges[g]);
+        o += line;
+    }
+    std::snprintf(line, sizeof line, "# TYPE dispatch_driver_utilization gauge\ndispatch_driver_utilization %.4f\n", driverUtilization());
+    o += line;
+    // summaries: quantiles come from the log-linear buckets
+    static const double qs[] = {0.5, 0.9, 0.99, 0.999};
+    for(size_t h=0;h<histograms.size();h++){
+        const char *name = histogramName((Histogram)h);
+        const HistogramSnapshot &hs = histograms[h];
+        std::snprintf(line, sizeof line, "# TYPE %s summary\n", name);
+        o += line;
+        for(double q: qs){
+            std::snprintf(line, sizeof line, "%s{quantile=\"%g\"} %llu\n", name, q, (unsigned long long)hs.quantile(q));
+            o += line;
+        }
+        std::snprintf(line, sizeof line, "%s_sum %llu\n%s_count %llu\n", name, (unsigned long long)hs.sum,
+                      name, (unsigned long long)hs.count);
+        o += line;
+        // a summary has no max sample; export it as its own gauge
+        std::snprintf(line, sizeof line, "# TYPE %s_max gauge\n%s_max %llu\n", name, name, (unsigned long long)hs.max);
+        o += line;
+    }
+    std::snprintf(line, sizeof line, "# TYPE dispatch_uptime_seconds gauge\ndispatch_uptime_seconds %.3f\n", uptimeSeconds);
+    o += line;
+    return o;
+}
+
+// write to a temp file and rename, so scrapers never read a half-written dump
+static void writeDump(const std::string &path){
+    std::string text = Metrics::snapshot().toPrometheus();
+    std::string tmp = path + ".tmp";
+    FILE *f = std::fopen(tmp.c_str(), "w");
+    if(!f) return;
+    std::fwrite(text.data(), 1, text.size(), f);
+    std::fclose(f);
+    std::rename(tmp.c_str(), path.c_str());
+}
+
+void Metrics::startDump(const std::string &path, std::chrono::milliseconds interval){
+    stopDump();
+    auto &r = Registry::instance();
+    std::lock_guard<std::mutex> lg(r.mtx);
+    r.dumping = true;
+    r.dumper = std::thread([path, interval]{
+        auto &r = Registry::instance();
+        std::unique_lock<std::mutex> lk(r.mtx);
+        while(r.dumping){
+            r.cv.wait_for(lk, interval, [&]{ return !r.dumping; });
+            lk.unlock();
+            writeDump(path); // also runs once on stop, so the file ends up final
+            lk.lock();
+        }
+    });
+}
+
+void Metrics::stopDump(){
+    auto &r = Registry::instance();
+    std::thread t;
+    {
+        std::lock_guard<std::mutex> lg(r.mtx);
+        r.dumping = false;
+        t = std::move(r.dumper);
+    }
+    r.cv.notify_all();
+    if(t.joinable()) t.join();
+}
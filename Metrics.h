@@ -0,0 +1,143 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Dispatcher metrics. Counters and latency histograms are sharded per thread:
+// recording is a relaxed load/store on the calling thread's own shard, with no
+// locks and no shared cache lines. Readers merge the shards into a snapshot.
+// Gauges are single process-wide atomics.
+//
+//   Metrics::inc(Counter::ASSIGNMENTS);
+//   { METRICS_TIMER(Histogram::ASSIGN_NS); strategy->assign(...); }
+//   Metrics::startDump("metrics.prom", std::chrono::seconds(10));
+
+enum class Counter : uint8_t {
+    ORDERS_SUBMITTED,
+    ORDERS_CANCELLED,
+    ORDERS_REJECTED,   // submitted while the order pool was exhausted
+    ASSIGNMENTS,
+    DISPATCH_ROUNDS,
+    DRIVER_BUSY_NS,    // summed wall time drivers spent serving orders
+    DISTANCE_CACHE_HITS,
+    DISTANCE_CACHE_MISSES,
+    ORDERS_STOLEN,     // queued orders moved to an idle driver by work stealing
+    RELOCATIONS,       // idle drivers sent toward forecast demand
+    COUNT
+};
+
+enum class Histogram : uint8_t {
+    QUEUE_WAIT_NS,          // order creation -> assignment
+    DISPATCH_LOCK_HOLD_NS,  // time Dispatcher::mtx is held per dispatch round
+    ASSIGN_NS,              // AssignmentStrategy::assign duration
+    SHORTEST_PATH_NS,       // Graph::distanceTable duration
+    ASSIGNMENTS_PER_ROUND,
+    COUNT
+};
+
+enum class Gauge : uint8_t {
+    DRIVERS_REGISTERED,
+    DRIVERS_BUSY,
+    ORDERS_QUEUED,
+    COUNT
+};
+
+namespace metricsdetail {
+
+// log-linear buckets (HDR style): 8 linear sub-buckets per power of two,
+// so any recorded value is reported within 12.5%; values up to 2^48
+const int SUB_BITS = 3;
+const int SUB_COUNT = 1 << SUB_BITS;
+const int BUCKETS = (48 - SUB_BITS + 1) * SUB_COUNT;
+
+inline int bucketOf(uint64_t v){
+    if(v < (uint64_t)SUB_COUNT) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    if(e >= 48) return BUCKETS - 1;
+    int sub = (int)((v >> (e - SUB_BITS)) & (SUB_COUNT - 1));
+    return (e - SUB_BITS + 1) * SUB_COUNT + sub;
+}
+
+// largest value that falls in bucket b
+inline uint64_t bucketUpper(int b){
+    if(b < SUB_COUNT) return (uint64_t)b;
+    int e = b / SUB_COUNT + SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(b % SUB_COUNT);
+    return ((SUB_COUNT + sub + 1) << (e - SUB_BITS)) - 1;
+}
+
+struct Shard;
+Shard& localShard();
+void add(Shard &s, Counter c, uint64_t n);
+void record(Shard &s, Histogram h, uint64_t v);
+
+} // namespace metricsdetail
+
+struct HistogramSnapshot {
+    uint64_t count{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+    std::array<uint64_t, metricsdetail::BUCKETS> buckets{};
+
+    // upper bound of the bucket holding the q-th quantile (0 when empty)
+    uint64_t quantile(double q) const;
+    double mean() const { return count ? (double)sum / count : 0.0; }
+};
+
+struct MetricsSnapshot {
+    std::array<uint64_t, (size_t)Counter::COUNT> counters{};
+    std::array<long long, (size_t)Gauge::COUNT> gauges{};
+    std::array<HistogramSnapshot, (size_t)Histogram::COUNT> histograms{};
+    double uptimeSeconds{0};
+
+    uint64_t counter(Counter c) const { return counters[(size_t)c]; }
+    long long gauge(Gauge g) const { return gauges[(size_t)g]; }
+    const HistogramSnapshot& histogram(Histogram h) const { return histograms[(size_t)h]; }
+
+    // busy / registered drivers at snapshot time; rate(DRIVER_BUSY_NS) gives the time average
+    double driverUtilization() const;
+    std::string toPrometheus() const;
+};
+
+struct Metrics {
+    static void inc(Counter c, uint64_t n = 1){ metricsdetail::add(metricsdetail::localShard(), c, n); }
+    static void record(Histogram h, uint64_t v){ metricsdetail::record(metricsdetail::localShard(), h, v); }
+
+    // nanoseconds elapsed since t on t's own clock (clamped at zero)
+    template<typename Clock, typename Dur>
+    static void recordSince(Histogram h, std::chrono::time_point<Clock, Dur> t){
+        long long ns = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t).count();
+        record(h, ns > 0 ? (uint64_t)ns : 0);
+    }
+
+    static void setGauge(Gauge g, long long v){ gauges[(size_t)g].store(v, std::memory_order_relaxed); }
+    static void addGauge(Gauge g, long long d){ gauges[(size_t)g].fetch_add(d, std::memory_order_relaxed); }
+
+    static MetricsSnapshot snapshot();
+
+    // background thread rewriting `path` (Prometheus text format) every interval
+    static void startDump(const std::string &path, std::chrono::milliseconds interval);
+    static void stopDump();
+
+    static inline std::array<std::atomic<long long>, (size_t)Gauge::COUNT> gauges{};
+};
+
+// records the lifetime of the enclosing scope into a nanosecond histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram h): hist(h), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer(){
+        Metrics::record(hist, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+private:
+    Histogram hist;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define METRICS_CONCAT_(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_(a, b)
+#define METRICS_TIMER(h) ScopedTimer METRICS_CONCAT(metricsTimer_, __LINE__)(h)
@@ -0,0 +1,53 @@
+#include "MinCostFlow.h"
+#include <algorithm>
+#include <deque>
+#include <limits>
+
+MinCostFlow::MinCostFlow(int n_): n(n_), adj(n_) {}
+
+int MinCostFlow::addEdge(int from, int to, int cap, long long cost){
+    int id = (int)edges.size();
+    edges.push_back({to, cap, 0, cost});
+    adj[from].push_back(id);
+    edges.push_back({from, 0, 0, -cost});
+    adj[to].push_back(id + 1);
+    return id;
+}
+
+std::pair<int, long long> MinCostFlow::solve(int s, int t, int maxFlow){
+    const long long INF = std::numeric_limits<long long>::max() / 4;
+    int flow = 0;
+    long long cost = 0;
+    std::vector<long long> dist(n);
+    std::vector<int> via(n);
+    std::vector<char> queued(n);
+    while(flow < maxFlow){
+        // residual edges carry negative costs, so Bellman-Ford style (SPFA) rather than Dijkstra
+        std::fill(dist.begin(), dist.end(), INF);
+        std::fill(via.begin(), via.end(), -1);
+        std::deque<int> q{s};
+        dist[s] = 0;
+        queued[s] = 1;
+        while(!q.empty()){
+            int u = q.front(); q.pop_front();
+            queued[u] = 0;
+            for(int id: adj[u]){
+                const Edge &e = edges[id];
+                if(e.cap - e.flow <= 0 || dist[u] + e.cost >= dist[e.to]) continue;
+                dist[e.to] = dist[u] + e.cost;
+                via[e.to] = id;
+                if(!queued[e.to]){ queued[e.to] = 1; q.push_back(e.to); }
+            }
+        }
+        if(dist[t] == INF) break;
+        int push = maxFlow - flow;
+        for(int v=t; v!=s; v=edges[via[v] ^ 1].to) push = std::min(push, edges[via[v]].cap - edges[via[v]].flow);
+        for(int v=t; v!=s; v=edges[via[v] ^ 1].to){
+            edges[via[v]].flow += push;
+            edges[via[v] ^ 1].flow -= push;
+        }
+        flow += push;
+        cost += (long long)push * dist[t];
+    }
+    return {flow, cost};
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <utility>
+
+// Successive-shortest-path min-cost flow for small networks (a few hundred
+// nodes): each augmentation finds the cheapest residual path with SPFA and
+// pushes its bottleneck capacity. Costs may be any non-negative integers.
+class MinCostFlow {
+public:
+    explicit MinCostFlow(int n);
+
+    // returns the edge id, for flowOn()
+    int addEdge(int from, int to, int cap, long long cost);
+
+    // send up to maxFlow units from s to t; (flow sent, total cost)
+    std::pair<int, long long> solve(int s, int t, int maxFlow);
+
+    int flowOn(int edge) const { return edges[edge].flow; }
+
+private:
+    struct Edge {
+        int to, cap, flow;
+        long long cost;
+    };
+    int n;
+    std::vector<Edge> edges;              // edge 2k and its reverse 2k+1
+    std::vector<std::vector<int>> adj;    // node -> edge ids
+};
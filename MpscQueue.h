@@ -0,0 +1,115 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+// Lock-free multi-producer / single-consumer queue (Vyukov style) over pooled
+// nodes. push() is a free-list pop, one atomic exchange and one store and never
+// waits on the consumer; pop() must only be called from one thread at a time.
+// Nodes live in fixed chunks that never move and are linked by index; the
+// consumer returns each one to a lock-free free list (tagged against ABA, as in
+// OrderPool), so after warm-up a push allocates nothing. The queue is bounded
+// at MAX_CHUNKS * CHUNK items in flight: a producer that finds every node in
+// use yields until the consumer frees one.
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue(){
+        grow();
+        uint32_t stub = popFree();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+    ~MpscQueue(){
+        while(pop()) {}
+        for(uint32_t c=0;c<chunkCount.load(std::memory_order_relaxed);c++) delete[] chunks[c].load(std::memory_order_relaxed);
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T v){
+        uint32_t n;
+        while((n = popFree()) == NIL){
+            if(!grow()) std::this_thread::yield(); // full: wait for the consumer
+        }
+        Node &node = at(n);
+        node.value.emplace(std::move(v));
+        node.next.store(NIL, std::memory_order_relaxed);
+        uint32_t prev = head.exchange(n, std::memory_order_acq_rel);
+        at(prev).next.store(n, std::memory_order_release);
+    }
+
+    // empty result when nothing is ready; an item whose producer is mid-push
+    // shows up on a later call
+    std::optional<T> pop(){
+        uint32_t next = at(tail).next.load(std::memory_order_acquire);
+        if(next == NIL) return std::nullopt;
+        Node &n = at(next);
+        std::optional<T> out(std::move(*n.value));
+        n.value.reset();
+        pushFree(tail); // the old sentinel; next becomes the new one
+        tail = next;
+        return out;
+    }
+
+private:
+    static constexpr uint32_t CHUNK = 1024;      // nodes per chunk
+    static constexpr uint32_t MAX_CHUNKS = 4096; // 4M items in flight
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        std::atomic<uint32_t> next{NIL};
+        std::atomic<uint32_t> nextFree{NIL};
+        std::optional<T> value;
+    };
+
+    std::array<std::atomic<Node*>, MAX_CHUNKS> chunks{};
+    std::atomic<uint32_t> chunkCount{0};
+    std::atomic<uint64_t> freeHead{NIL}; // tag << 32 | node
+    std::mutex growMtx;
+    std::atomic<uint32_t> head{NIL}; // last pushed node, shared by producers
+    uint32_t tail{NIL};              // sentinel before the oldest item, consumer only
+
+    Node& at(uint32_t i) const { return chunks[i / CHUNK].load(std::memory_order_acquire)[i % CHUNK]; }
+
+    uint32_t popFree(){
+        uint64_t h = freeHead.load(std::memory_order_acquire);
+        while((uint32_t)h != NIL){
+            uint32_t i = (uint32_t)h;
+            uint32_t next = at(i).nextFree.load(std::memory_order_relaxed);
+            uint64_t want = ((h >> 32) + 1) << 32 | next;
+            if(freeHead.compare_exchange_weak(h, want, std::memory_order_acq_rel, std::memory_order_acquire)) return i;
+        }
+        return NIL;
+    }
+
+    // link first..last (already chained through nextFree) in front of the list
+    void pushFree(uint32_t first, uint32_t last){
+        uint64_t h = freeHead.load(std::memory_order_relaxed);
+        while(true){
+            at(last).nextFree.store((uint32_t)h, std::memory_order_relaxed);
+            uint64_t want = ((h >> 32) + 1) << 32 | first;
+            if(freeHead.compare_exchange_weak(h, want, std::memory_order_release, std::memory_order_relaxed)) return;
+        }
+    }
+    void pushFree(uint32_t i){ pushFree(i, i); }
+
+    // false once MAX_CHUNKS are in use
+    bool grow(){
+        std::lock_guard<std::mutex> lg(growMtx);
+        if((uint32_t)freeHead.load(std::memory_order_acquire) != NIL) return true; // another producer grew it
+        uint32_t c = chunkCount.load(std::memory_order_relaxed);
+        if(c == MAX_CHUNKS) return false;
+        Node *chunk = new Node[CHUNK];
+        uint32_t base = c * CHUNK;
+        for(uint32_t i=0;i+1<CHUNK;i++) chunk[i].nextFree.store(base + i + 1, std::memory_order_relaxed);
+        chunks[c].store(chunk, std::memory_order_release);
+        chunkCount.store(c + 1, std::memory_order_release);
+        pushFree(base, base + CHUNK - 1);
+        return true;
+    }
+};
@@ -0,0 +1,107 @@
+#include "NodeLocator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+NodeLocator::NodeLocator(const Graph &g){
+    if(g.coords.size() != (size_t)g.n || g.n == 0) return;
+    // equirectangular: longitude shrinks with the cosine of the latitude
+    double latSum = 0;
+    for(auto &c: g.coords) latSum += c.lat;
+    lonScale = (float)std::cos(latSum / g.n * 3.14159265358979 / 180.0);
+    std::vector<float> x(g.n), y(g.n);
+    for(int u=0;u<g.n;u++){ x[u] = g.coords[u].lon * lonScale; y[u] = g.coords[u].lat; }
+
+    std::vector<int> segFrom, segTo; // from <= to
+    for(int u=0;u<g.n;u++){
+        bool any = false;
+        g.forEachNeighbour(u, [&](int v, int){
+            any = true;
+            if(u < v){ segFrom.push_back(u); segTo.push_back(v); }
+        });
+        if(!any){ segFrom.push_back(u); segTo.push_back(u); } // isolated node: a point segment
+    }
+
+    minX = *std::min_element(x.begin(), x.end());
+    minY = *std::min_element(y.begin(), y.end());
+    float spanX = std::max(1e-6f, *std::max_element(x.begin(), x.end()) - minX);
+    float spanY = std::max(1e-6f, *std::max_element(y.begin(), y.end()) - minY);
+    // about one segment per cell, cells roughly square
+    double cells = std::max<double>(1.0, (double)segFrom.size());
+    double side = std::sqrt(spanX * (double)spanY / cells);
+    cols = std::max(1, std::min(4096, (int)std::ceil(spanX / side)));
+    rows = std::max(1, std::min(4096, (int)std::ceil(spanY / side)));
+    cellW = spanX / cols;
+    cellH = spanY / rows;
+
+    // counting sort of segments into every cell their bounding box touches
+    auto forCells = [&](int s, auto &&f){
+        int a = segFrom[s], b = segTo[s];
+        int x0 = cellX(std::min(x[a], x[b])), x1 = cellX(std::max(x[a], x[b]));
+        int y0 = cellY(std::min(y[a], y[b])), y1 = cellY(std::max(y[a], y[b]));
+        for(int cy=y0;cy<=y1;cy++) for(int cx=x0;cx<=x1;cx++) f(cy * cols + cx);
+    };
+    cellStart.assign((size_t)cols * rows + 1, 0);
+    for(int s=0;s<(int)segFrom.size();s++) forCells(s, [&](int c){ cellStart[c + 1]++; });
+    for(size_t c=0;c+1<cellStart.size();c++) cellStart[c + 1] += cellStart[c];
+    cellSegs.resize(cellStart.back());
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for(int s=0;s<(int)segFrom.size();s++){
+        int a = segFrom[s], b = segTo[s];
+        float dx = x[b] - x[a], dy = y[b] - y[a], len2 = dx * dx + dy * dy;
+        Segment seg{x[a], y[a], x[b], y[b], len2 > 0 ? 1.0f / len2 : 0.0f, a, b};
+        forCells(s, [&](int c){ cellSegs[fill[c]++] = seg; });
+    }
+}
+
+int NodeLocator::cellX(float px) const { return std::min(cols - 1, std::max(0, (int)((px - minX) / cellW))); }
+int NodeLocator::cellY(float py) const { return std::min(rows - 1, std::max(0, (int)((py - minY) / cellH))); }
+
+// squared distance from (px,py) to the box [x0,x1] x [y0,y1]
+static float boxDist2(float px, float py, float x0, float x1, float y0, float y1){
+    float dx = std::max(0.0f, std::max(x0 - px, px - x1));
+    float dy = std::max(0.0f, std::max(y0 - py, py - y1));
+    return dx * dx + dy * dy;
+}
+
+int NodeLocator::snap(float lat, float lon) const {
+    if(empty()) return -1;
+    const float px = lon * lonScale, py = lat;
+    const int cx = cellX(px), cy = cellY(py);
+    float best = std::numeric_limits<float>::max();
+    int bestNode = -1;
+
+    auto visit = [&](int c){
+        for(int k=cellStart[c];k<cellStart[c + 1];k++){
+            const Segment &s = cellSegs[k];
+            float dx = s.bx - s.ax, dy = s.by - s.ay;
+            float t = std::min(1.0f, std::max(0.0f, ((px - s.ax) * dx + (py - s.ay) * dy) * s.invLen2));
+            float ex = s.ax + t * dx - px, ey = s.ay + t * dy - py;
+            float d2 = ex * ex + ey * ey;
+            if(d2 < best){ best = d2; bestNode = t < 0.5f ? s.a : s.b; }
+        }
+    };
+    for(int r=0;;r++){
+        // ring r: cells at Chebyshev distance r from the point's cell
+        for(int yy=cy-r;yy<=cy+r;yy++){
+            if(yy < 0 || yy >= rows) continue;
+            bool edgeRow = yy == cy - r || yy == cy + r;
+            for(int xx=cx-r;xx<=cx+r;xx+=(edgeRow ? 1 : 2 * r)){
+                if(xx >= 0 && xx < cols) visit(yy * cols + xx);
+                if(r == 0) break;
+            }
+        }
+        // anything not seen yet lies in the strips of the grid around the scanned block
+        const float gx0 = minX, gx1 = minX + cols * cellW, gy0 = minY, gy1 = minY + rows * cellH;
+        const float bx0 = minX + (cx - r) * cellW, bx1 = minX + (cx + r + 1) * cellW;
+        const float by0 = minY + (cy - r) * cellH, by1 = minY + (cy + r + 1) * cellH;
+        float reach = std::numeric_limits<float>::max();
+        if(cx - r > 0) reach = std::min(reach, boxDist2(px, py, gx0, bx0, gy0, gy1));
+        if(cx + r < cols - 1) reach = std::min(reach, boxDist2(px, py, bx1, gx1, gy0, gy1));
+        if(cy - r > 0) reach = std::min(reach, boxDist2(px, py, gx0, gx1, gy0, by0));
+        if(cy + r < rows - 1) reach = std::min(reach, boxDist2(px, py, gx0, gx1, by1, gy1));
+        if(reach == std::numeric_limits<float>::max()) break; // whole grid seen
+        if(bestNode >= 0 && best <= reach) break;
+    }
+    return bestNode;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include "Graph.h"
+
+// Snaps raw coordinates onto the road network. Every road segment (and every
+// node without roads) is filed under the cells of a uniform grid over
+// Graph::coords that its bounding box touches; a lookup scans rings of cells
+// around the point until no unseen segment can be closer, then returns the
+// endpoint of the nearest segment on the point's side of it. Distances use an
+// equirectangular projection, which is accurate at city scale.
+class NodeLocator {
+public:
+    explicit NodeLocator(const Graph &g);
+
+    bool empty() const { return cellStart.empty(); } // graph without coordinates: nothing snaps
+    // nearest node along the nearest road, or -1 when empty
+    int snap(float lat, float lon) const;
+
+private:
+    // a segment filed under a cell, with its projected endpoints inline so a
+    // lookup reads each cell's list sequentially
+    struct Segment {
+        float ax, ay, bx, by;
+        float invLen2; // 0 for a point
+        int a, b;
+    };
+    std::vector<int> cellStart;       // cell -> range in cellSegs
+    std::vector<Segment> cellSegs;
+    int cols{0}, rows{0};
+    float minX{0}, minY{0}, cellW{1}, cellH{1}, lonScale{1};
+
+    int cellX(float px) const;
+    int cellY(float py) const;
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <chrono>
 #include <atomic>
+#include <vector>
 
 enum class OrderStatus { QUEUED, ASSIGNED, IN_PROGRESS, COMPLETED, CANCELLED };
 
@@ -17,3 +18,36 @@ struct Order {
         : id(id_), pickup(p_), dropoff(d_), fare(fare_), passengerId(pid), status(OrderStatus::QUEUED),
           created(std::chrono::system_clock::now()) {}
 };
+
+// Read-only view of orders that live elsewhere (pool slots, a caller's vector),
+// indexed and iterated like a vector<Order> but holding only pointers, so a
+// dispatch round hands its queue to the strategy without copying it.
+class OrderSpan {
+public:
+    OrderSpan() = default;
+    OrderSpan(const std::vector<Order> &v){
+        ptr.reserve(v.size());
+        for(auto &o: v) ptr.push_back(&o);
+    }
+
+    void reserve(size_t n){ ptr.reserve(n); }
+    void push_back(const Order *o){ ptr.push_back(o); }
+
+    const Order& operator[](size_t i) const { return *ptr[i]; }
+    size_t size() const { return ptr.size(); }
+    bool empty() const { return ptr.empty(); }
+
+    struct iterator {
+        std::vector<const Order*>::const_iterator it;
+        const Order& operator*() const { return **it; }
+        const Order* operator->() const { return *it; }
+        iterator& operator++(){ ++it; return *this; }
+        bool operator!=(const iterator &o) const { return it != o.it; }
+        bool operator==(const iterator &o) const { return it == o.it; }
+    };
+    iterator begin() const { return iterator{ptr.begin()}; }
+    iterator end() const { return iterator{ptr.end()}; }
+
+private:
+    std::vector<const Order*> ptr;
+};
@@ -0,0 +1,69 @@
+#include "OrderBook.h"
+
+OrderHandle OrderBook::insert(PooledOrder o){
+    if(!o || index.count(o->id)) return OrderHandle{};
+    int id = o->id;
+    uint32_t s;
+    if(freeList != NIL){
+        s = freeList;
+        freeList = slots[s].next;
+    } else {
+        s = (uint32_t)slots.size();
+        slots.emplace_back();
+    }
+    Slot &sl = slots[s];
+    sl.order = std::move(o);
+    sl.prev = tail;
+    sl.next = NIL;
+    if(tail != NIL) slots[tail].next = s; else head = s;
+    tail = s;
+    index[id] = s;
+    return OrderHandle{s, sl.gen};
+}
+
+Order* OrderBook::find(int orderId){
+    auto it = index.find(orderId);
+    return it == index.end() ? nullptr : &*slots[it->second].order;
+}
+
+Order* OrderBook::get(OrderHandle h){
+    if(h.slot >= slots.size() || slots[h.slot].gen != h.gen || !slots[h.slot].order) return nullptr;
+    return &*slots[h.slot].order;
+}
+
+bool OrderBook::erase(int orderId){
+    return (bool)take(orderId);
+}
+
+PooledOrder OrderBook::take(int orderId){
+    auto it = index.find(orderId);
+    if(it == index.end()) return PooledOrder();
+    uint32_t s = it->second;
+    index.erase(it);
+    PooledOrder out = std::move(slots[s].order);
+    unlink(s);
+    return out;
+}
+
+bool OrderBook::erase(OrderHandle h){
+    Order *o = get(h);
+    return o && erase(o->id);
+}
+
+void OrderBook::unlink(uint32_t s){
+    Slot &sl = slots[s];
+    if(sl.prev != NIL) slots[sl.prev].next = sl.next; else head = sl.next;
+    if(sl.next != NIL) slots[sl.next].prev = sl.prev; else tail = sl.prev;
+    sl.order.reset(); // releases the pool slot unless taken
+    sl.gen++; // outstanding handles go stale
+    sl.prev = NIL;
+    sl.next = freeList;
+    freeList = s;
+}
+
+OrderSpan OrderBook::snapshot() const {
+    OrderSpan out;
+    out.reserve(index.size());
+    forEach([&](const Order &o){ out.push_back(&o); });
+    return out;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "models/Order.h"
+#include "models/OrderPool.h"
+
+// Generation-checked reference to an order slot; stale once the order is removed.
+struct OrderHandle {
+    uint32_t slot{UINT32_MAX};
+    uint32_t gen{0};
+    bool valid() const { return slot != UINT32_MAX; }
+};
+
+// Queued orders in a slot map with an id index: O(1) insert, lookup and removal,
+// freed slots are recycled, and a linked list through the slots keeps creation
+// order for the strategies. The book owns its orders' pool slots while they wait.
+class OrderBook {
+public:
+    // invalid handle if an order with the same id is already queued (o is then released)
+    OrderHandle insert(PooledOrder o);
+    OrderHandle insert(const Order &o){ return insert(OrderPool::instance().acquire(o)); }
+
+    // remove and hand over ownership, e.g. to the assigned driver; empty if not queued
+    PooledOrder take(int orderId);
+
+    Order* find(int orderId);
+    Order* get(OrderHandle h);
+
+    bool erase(int orderId);
+    bool erase(OrderHandle h);
+
+    size_t size() const { return index.size(); }
+    bool empty() const { return index.empty(); }
+
+    // the queued orders in place, oldest first; valid until the book next changes
+    OrderSpan snapshot() const;
+
+    template<typename F> void forEach(F f) const {
+        for(uint32_t s = head; s != NIL; s = slots[s].next) f(*slots[s].order);
+    }
+
+private:
+    static const uint32_t NIL = UINT32_MAX;
+    struct Slot {
+        PooledOrder order;
+        uint32_t gen{0};
+        uint32_t prev{NIL}, next{NIL}; // creation-order links, or free-list link in next
+    };
+    std::vector<Slot> slots;
+    std::unordered_map<int, uint32_t> index; // order id -> slot
+    uint32_t head{NIL}, tail{NIL}, freeList{NIL};
+
+    void unlink(uint32_t s);
+};
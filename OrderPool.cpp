@@ -0,0 +1,67 @@
+#include "OrderPool.h"
+#include "../utils/Logger.h"
+
+OrderPool& OrderPool::instance(){
+    // never destroyed: orders held by other statics may be released during exit
+    static OrderPool *pool = new OrderPool();
+    return *pool;
+}
+
+uint32_t OrderPool::popFree(){
+    uint64_t head = freeHead.load(std::memory_order_acquire);
+    while((uint32_t)head != NIL){
+        uint32_t slot = (uint32_t)head;
+        uint32_t next = at(slot).nextFree.load(std::memory_order_relaxed);
+        uint64_t want = ((head >> 32) + 1) << 32 | next;
+        if(freeHead.compare_exchange_weak(head, want, std::memory_order_acq_rel, std::memory_order_acquire)) return slot;
+    }
+    return NIL;
+}
+
+// link first..last (already chained through nextFree) in front of the list
+void OrderPool::pushFree(uint32_t first, uint32_t last){
+    uint64_t head = freeHead.load(std::memory_order_relaxed);
+    while(true){
+        at(last).nextFree.store((uint32_t)head, std::memory_order_relaxed);
+        uint64_t want = ((head >> 32) + 1) << 32 | first;
+        if(freeHead.compare_exchange_weak(head, want, std::memory_order_release, std::memory_order_relaxed)) return;
+    }
+}
+
+bool OrderPool::grow(){
+    std::lock_guard<std::mutex> lg(growMtx);
+    if((uint32_t)freeHead.load(std::memory_order_acquire) != NIL) return true; // another thread grew it
+    uint32_t c = chunkCount.load(std::memory_order_relaxed);
+    if(c == MAX_CHUNKS) return false;
+    Slot *chunk = new Slot[CHUNK];
+    uint32_t base = c * CHUNK;
+    for(uint32_t i=0;i+1<CHUNK;i++) chunk[i].nextFree.store(base + i + 1, std::memory_order_relaxed);
+    chunks[c].store(chunk, std::memory_order_release);
+    chunkCount.store(c + 1, std::memory_order_release);
+    pushFree(base, base + CHUNK - 1);
+    return true;
+}
+
+PooledOrder OrderPool::acquire(const Order &o){
+    uint32_t slot;
+    while((slot = popFree()) == NIL){
+        if(!grow()){
+            LOG_ERROR("OrderPool: {} orders live, pool exhausted; dropping Order {}", live(), o.id);
+            return PooledOrder();
+        }
+    }
+    Slot &s = at(slot);
+    s.order = o;
+    inUse.fetch_add(1, std::memory_order_relaxed);
+    return PooledOrder(OrderRef{slot, s.gen.load(std::memory_order_relaxed)});
+}
+
+void OrderPool::release(OrderRef ref){
+    Slot &s = at(ref.slot);
+    if(!s.gen.compare_exchange_strong(ref.gen, ref.gen + 1, std::memory_order_acq_rel)){
+        LOG_ERROR("OrderPool: slot {} released twice, ignored", ref.slot);
+        return;
+    }
+    inUse.fetch_sub(1, std::memory_order_relaxed);
+    pushFree(ref.slot, ref.slot);
+}
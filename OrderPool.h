@@ -0,0 +1,100 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "Order.h"
+
+// Slot of a pooled order plus the slot's generation when it was handed out.
+// Releasing the order bumps the generation, so a copy kept past that is stale
+// and OrderPool::get() returns null for it instead of the slot's next order.
+struct OrderRef {
+    uint32_t slot{UINT32_MAX};
+    uint32_t gen{0};
+    bool valid() const { return slot != UINT32_MAX; }
+};
+
+class PooledOrder;
+
+// Process-wide slab of orders. An order is copied in once at intake and then
+// lives in its slot until completed or cancelled; the dispatcher and drivers
+// pass it along as a move-only PooledOrder (a pooled ride's driver holds it
+// until the dropoff, a cancelling driver hands it back), so handing it over
+// neither allocates nor copies. The slot is the one live copy: its status is
+// written by whoever owns the order, and strategies read queued orders in
+// place (OrderSpan). OrderStore only journals the transitions; it is read back
+// after a restart, never to learn a live order's state. Slots come in fixed
+// chunks that never move; freed slots go on a lock-free list.
+class OrderPool {
+public:
+    static OrderPool& instance();
+
+    // copy o into a free slot; empty when the pool is exhausted
+    PooledOrder acquire(const Order &o);
+
+    // the order behind ref, or null once it has been released (stale handle)
+    Order* get(OrderRef ref) const {
+        if(!ref.valid() || ref.slot >= capacity()) return nullptr;
+        Slot &s = at(ref.slot);
+        return s.gen.load(std::memory_order_acquire) == ref.gen ? &s.order : nullptr;
+    }
+
+    size_t live() const { return inUse.load(std::memory_order_relaxed); }
+    size_t capacity() const { return (size_t)chunkCount.load(std::memory_order_acquire) * CHUNK; }
+
+private:
+    friend class PooledOrder;
+    static constexpr uint32_t CHUNK = 4096;      // slots per chunk
+    static constexpr uint32_t MAX_CHUNKS = 4096; // 16M live orders
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Slot {
+        Order order{0, 0, 0, 0.0};
+        std::atomic<uint32_t> gen{0};
+        std::atomic<uint32_t> nextFree{NIL};
+    };
+
+    std::array<std::atomic<Slot*>, MAX_CHUNKS> chunks{};
+    std::atomic<uint32_t> chunkCount{0};
+    std::atomic<uint64_t> freeHead{NIL}; // tag << 32 | slot; the tag defeats ABA
+    std::atomic<size_t> inUse{0};
+    std::mutex growMtx;
+
+    OrderPool() = default;
+    Slot& at(uint32_t slot) const { return chunks[slot / CHUNK].load(std::memory_order_acquire)[slot % CHUNK]; }
+    uint32_t popFree();
+    void pushFree(uint32_t first, uint32_t last);
+    bool grow();
+    void release(OrderRef ref);
+};
+
+// Sole owner of a pooled order: move-only, releases the slot when destroyed.
+class PooledOrder {
+public:
+    PooledOrder() = default;
+    PooledOrder(PooledOrder &&o) noexcept: r(o.r) { o.r = OrderRef{}; }
+    PooledOrder& operator=(PooledOrder &&o) noexcept {
+        if(this != &o){ reset(); r = o.r; o.r = OrderRef{}; }
+        return *this;
+    }
+    PooledOrder(const PooledOrder&) = delete;
+    PooledOrder& operator=(const PooledOrder&) = delete;
+    ~PooledOrder(){ reset(); }
+
+    explicit operator bool() const { return r.valid(); }
+    // checked against the slot's generation: null if the slot was released under us
+    Order* operator->() const { return OrderPool::instance().get(r); }
+    Order& operator*() const { return *operator->(); }
+    OrderRef ref() const { return r; }
+
+    // give the slot back now
+    void reset(){
+        if(r.valid()) OrderPool::instance().release(r);
+        r = OrderRef{};
+    }
+
+private:
+    friend class OrderPool;
+    explicit PooledOrder(OrderRef ref): r(ref) {}
+    OrderRef r;
+};
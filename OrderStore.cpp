@@ -0,0 +1,348 @@
+#include "OrderStore.h"
+#include "../utils/Crc32.h"
+#include "../utils/Logger.h"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'R','H','O','R','D','S','N','1'};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t upTo;   // journal records with seq <= upTo are already included
+    uint64_t count;
+    uint32_t crc;    // over the records
+    uint32_t pad;
+};
+
+bool terminal(OrderStatus s){ return s == OrderStatus::COMPLETED || s == OrderStatus::CANCELLED; }
+
+bool writeAll(int fd, const char *p, size_t n){
+    while(n > 0){
+        ssize_t w = ::write(fd, p, n);
+        if(w < 0){
+            if(errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+bool readFile(const std::string &path, std::vector<char> &out){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if(ok){
+        out.resize((size_t)st.st_size);
+        size_t got = 0;
+        while(ok && got < out.size()){
+            ssize_t r = ::read(fd, out.data() + got, out.size() - got);
+            if(r < 0 && errno == EINTR) continue;
+            if(r <= 0) ok = false;
+            else got += (size_t)r;
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+OrderStore::OrderStore() {}
+
+OrderStore::OrderStore(Options o): opts(std::move(o)) {
+    if(opts.dir.empty()) return;
+    ::mkdir(opts.dir.c_str(), 0755);
+    replay();
+    fd = ::open(journalPath().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(fd < 0){
+        LOG_ERROR("Order journal {} could not be opened; orders are kept in memory only", journalPath());
+        return;
+    }
+    durableSeq = seq;
+    committer = std::thread([this]{ commitLoop(); });
+}
+
+OrderStore::~OrderStore(){
+    {
+        std::lock_guard<std::mutex> lg(mtx);
+        stopping = true;
+    }
+    commitCv.notify_all();
+    if(committer.joinable()) committer.join();
+    if(fd >= 0) ::close(fd);
+}
+
+OrderStore::Record OrderStore::encode(const Order &o, int driverId){
+    Record r;
+    std::memset(&r, 0, sizeof r);
+    r.kind = PUT;
+    r.id = o.id;
+    r.pickup = o.pickup;
+    r.dropoff = o.dropoff;
+    r.fare = o.fare;
+    r.passengerId = o.passengerId;
+    r.status = (uint8_t)o.status;
+    r.driverId = driverId;
+    r.created = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(o.created.time_since_epoch()).count();
+    return r;
+}
+
+Order OrderStore::decode(const Record &r){
+    Order o(r.id, r.pickup, r.dropoff, r.fare, r.passengerId);
+    o.status = (OrderStatus)r.status;
+    o.created = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(r.created)));
+    return o;
+}
+
+void OrderStore::append(Record r){
+    r.seq = ++seq;
+    if(fd < 0) return;
+    uint32_t crc = crc32(&r, sizeof r);
+    const char *c = (const char*)&crc, *p = (const char*)&r;
+    pending.insert(pending.end(), c, c + sizeof crc);
+    pending.insert(pending.end(), p, p + sizeof r);
+    if(++sinceSnapshot >= opts.snapshotEvery && !snapshotRequested){
+        snapshotRequested = true;
+        commitCv.notify_one();
+    }
+}
+
+void OrderStore::apply(const Record &r){
+    if(r.kind == PUT){
+        if(terminal((OrderStatus)r.status)) orders.erase(r.id);
+        else orders.insert_or_assign(r.id, r);
+    } else if(r.kind == STATUS){
+        auto it = orders.find(r.id);
+        if(it == orders.end()) return;
+        OrderStatus s = (OrderStatus)r.status;
+        if(terminal(s)){
+            orders.erase(it);
+            return;
+        }
+        it->second.status = r.status;
+        it->second.driverId = r.driverId;
+    }
+}
+
+void OrderStore::put(const Order &o){
+    std::lock_guard<std::mutex> lg(mtx);
+    Record r = encode(o, -1);
+    orders.insert_or_assign(o.id, r);
+    append(r);
+}
+
+bool OrderStore::transition(int orderId, OrderStatus s, int driverId){
+    std::lock_guard<std::mutex> lg(mtx);
+    auto it = orders.find(orderId);
+    if(it == orders.end()) return false;
+    Record r;
+    std::memset(&r, 0, sizeof r);
+    r.kind = STATUS;
+    r.id = orderId;
+    r.status = (uint8_t)s;
+    r.driverId = driverId;
+    append(r);
+    if(terminal(s)){
+        orders.erase(it);
+    } else {
+        it->second.status = (uint8_t)s;
+        it->second.driverId = driverId;
+    }
+    return true;
+}
+
+std::optional<Order> OrderStore::get(int orderId) const {
+    std::lock_guard<std::mutex> lg(mtx);
+    auto it = orders.find(orderId);
+    if(it == orders.end()) return std::nullopt;
+    return decode(it->second);
+}
+
+int OrderStore::driverOf(int orderId) const {
+    std::lock_guard<std::mutex> lg(mtx);
+    auto it = orders.find(orderId);
+    return it == orders.end() ? -1 : it->second.driverId;
+}
+
+std::vector<Order> OrderStore::live() const {
+    std::lock_guard<std::mutex> lg(mtx);
+    std::vector<Order> out;
+    out.reserve(orders.size());
+    for(auto &p: orders) out.push_back(decode(p.second));
+    return out;
+}
+
+size_t OrderStore::size() const {
+    std::lock_guard<std::mutex> lg(mtx);
+    return orders.size();
+}
+
+uint64_t OrderStore::lastSequence() const {
+    std::lock_guard<std::mutex> lg(mtx);
+    return seq;
+}
+
+bool OrderStore::waitDurable(uint64_t s){
+    std::unique_lock<std::mutex> lk(mtx);
+    if(fd < 0) return false;
+    commitCv.notify_one(); // do not sit out the rest of the commit interval
+    uint64_t seen = failures;
+    durableCv.wait(lk, [&]{ return durableSeq >= s || stopping || (failures != seen && failedUpTo >= s); });
+    return durableSeq >= s;
+}
+
+bool OrderStore::snapshotNow(){
+    std::unique_lock<std::mutex> lk(mtx);
+    if(fd < 0) return false;
+    snapshotRequested = true;
+    uint64_t target = seq;
+    commitCv.notify_one();
+    uint64_t seen = failures;
+    durableCv.wait(lk, [&]{ return (durableSeq >= target && !snapshotRequested) || stopping || failures != seen; });
+    return snapshotSeq >= target;
+}
+
+void OrderStore::replay(){
+    uint64_t upTo = 0;
+    std::vector<char> buf;
+    if(readFile(snapshotPath(), buf) && buf.size() >= sizeof(SnapshotHeader)){
+        SnapshotHeader h;
+        std::memcpy(&h, buf.data(), sizeof h);
+        size_t bytes = (size_t)h.count * sizeof(Record);
+        if(std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof h.magic) == 0 && buf.size() - sizeof h == bytes
+           && crc32(buf.data() + sizeof h, bytes) == h.crc){
+            for(uint64_t i=0;i<h.count;i++){
+                Record r;
+                std::memcpy(&r, buf.data() + sizeof h + i * sizeof r, sizeof r);
+                apply(r);
+            }
+            upTo = seq = h.upTo;
+        } else {
+            LOG_ERROR("Order snapshot {} is corrupt, replaying the journal alone", snapshotPath());
+        }
+    }
+
+    buf.clear();
+    if(!readFile(journalPath(), buf)) return;
+    const size_t frame = sizeof(uint32_t) + sizeof(Record);
+    size_t pos = 0;
+    for(; pos + frame <= buf.size(); pos += frame){
+        uint32_t crc;
+        Record r;
+        std::memcpy(&crc, buf.data() + pos, sizeof crc);
+        std::memcpy(&r, buf.data() + pos + sizeof crc, sizeof r);
+        if(crc32(&r, sizeof r) != crc) break;
+        if(r.seq <= upTo) continue; // already in the snapshot
+        apply(r);
+        seq = std::max(seq, r.seq);
+        replayed++;
+    }
+    if(pos != buf.size()){
+        // torn or corrupt tail from a crash mid-write: drop it so new records follow valid ones
+        LOG_WARN("Order journal: discarding {} trailing bytes", buf.size() - pos);
+        if(::truncate(journalPath().c_str(), (off_t)pos) != 0) LOG_ERROR("Order journal could not be truncated");
+    }
+    sinceSnapshot = replayed;
+    LOG_INFO("Order store replayed {} journal records, {} live orders", replayed, orders.size());
+}
+
+// append buf and sync it. On failure the file is cut back to where it was, so the
+// retry, which rewrites all of buf, never leaves a torn frame inside the journal;
+// after a failed sync the written pages may already be gone, so syncing again is not enough
+bool OrderStore::writeOut(const std::vector<char> &buf){
+    if(buf.empty()) return true;
+    off_t at = ::lseek(fd, 0, SEEK_END);
+    bool ok = at >= 0 && writeAll(fd, buf.data(), buf.size());
+    if(!ok){
+        LOG_ERROR("Order journal write failed (errno {})", errno);
+    } else if(opts.sync && ::fdatasync(fd) != 0){
+        LOG_ERROR("Order journal sync failed (errno {})", errno);
+        ok = false;
+    }
+    if(!ok && at >= 0 && ::ftruncate(fd, at) != 0) LOG_ERROR("Order journal could not be cut back after a failed commit");
+    return ok;
+}
+
+bool OrderStore::writeSnapshot(const std::vector<Record> &recs, uint64_t upTo){
+    SnapshotHeader h;
+    std::memset(&h, 0, sizeof h);
+    std::memcpy(h.magic, SNAPSHOT_MAGIC, sizeof h.magic);
+    h.upTo = upTo;
+    h.count = recs.size();
+    h.crc = crc32(recs.data(), recs.size() * sizeof(Record));
+
+    std::string tmp = snapshotPath() + ".tmp";
+    int sfd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = sfd >= 0
+        && writeAll(sfd, (const char*)&h, sizeof h)
+        && writeAll(sfd, (const char*)recs.data(), recs.size() * sizeof(Record))
+        && ::fsync(sfd) == 0;
+    if(sfd >= 0) ::close(sfd);
+    // the journal is only cut once the snapshot has durably replaced the old one:
+    // the rename lives in the directory, which needs its own fsync
+    if(ok && std::rename(tmp.c_str(), snapshotPath().c_str()) == 0){
+        int dfd = ::open(opts.dir.c_str(), O_RDONLY | O_DIRECTORY);
+        bool renamed = dfd >= 0 && ::fsync(dfd) == 0;
+        if(dfd >= 0) ::close(dfd);
+        if(!renamed) LOG_ERROR("Order snapshot directory {} could not be synced; journal kept", opts.dir);
+        else if(::ftruncate(fd, 0) != 0) LOG_ERROR("Order journal could not be truncated after snapshot");
+        return renamed;
+    }
+    LOG_ERROR("Order snapshot {} could not be written", snapshotPath());
+    ::unlink(tmp.c_str());
+    return false;
+}
+
+void OrderStore::commitLoop(){
+    std::unique_lock<std::mutex> lk(mtx);
+    bool retrying = false; // after a failed commit, wait out the interval before the next attempt
+    while(true){
+        commitCv.wait_for(lk, opts.commitInterval, [&]{ return stopping || (snapshotRequested && !retrying); });
+        std::vector<char> buf;
+        buf.swap(pending);
+        uint64_t upTo = seq;
+        bool stop = stopping;
+        bool snap = snapshotRequested;
+        std::vector<Record> state;
+        if(snap){
+            state.reserve(orders.size());
+            for(auto &p: orders){
+                state.push_back(p.second);
+                state.back().seq = upTo;
+            }
+            sinceSnapshot = 0;
+        }
+        lk.unlock();
+
+        bool ok = writeOut(buf);
+        bool snapped = ok && snap && writeSnapshot(state, upTo);
+
+        lk.lock();
+        if(ok){
+            if(snap) snapshotRequested = false;
+            if(snapped) snapshotSeq = upTo;
+            durableSeq = upTo;
+        } else {
+            // keep the records, ahead of anything appended meanwhile, for the next attempt
+            buf.insert(buf.end(), pending.begin(), pending.end());
+            pending.swap(buf);
+            failedUpTo = upTo;
+            failures++;
+        }
+        retrying = !ok;
+        durableCv.notify_all();
+        if(stop){
+            if(!ok) LOG_ERROR("Order journal closed with records after {} not persisted", durableSeq);
+            break;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <optional>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdint>
+#include "models/Order.h"
+
+// Journal image of every order that has not reached a terminal state
+// (COMPLETED / CANCELLED), keyed by id: the last status written for it, not
+// the live one, which is the order's pool slot. Dispatchers only read it back
+// after a restart, or for an order no slot holds any more.
+//
+// With a directory configured, every change is appended to a checksummed
+// journal. Appends only copy a fixed-size record into a memory buffer; a
+// committer thread writes the buffer and fdatasyncs it once per commit
+// interval (group commit), so no caller waits on the disk unless it asks to
+// through waitDurable(). Every `snapshotEvery` records the live orders are
+// written to a snapshot and the journal restarts. Opening the store replays
+// snapshot + journal and cuts off a torn tail.
+class OrderStore {
+public:
+    struct Options {
+        std::string dir;                                // empty: in memory only
+        std::chrono::milliseconds commitInterval{5};
+        size_t snapshotEvery{100000};                   // journal records between snapshots
+        bool sync{true};                                // fdatasync each group commit
+    };
+
+    OrderStore(); // in memory only
+    explicit OrderStore(Options opts);
+    ~OrderStore();
+
+    OrderStore(const OrderStore&) = delete;
+    OrderStore& operator=(const OrderStore&) = delete;
+
+    // record a new order (or replace a known one)
+    void put(const Order &o);
+
+    // status change; driverId is kept for ASSIGNED / IN_PROGRESS.
+    // Terminal statuses drop the record. False if the order is unknown.
+    bool transition(int orderId, OrderStatus s, int driverId = -1);
+
+    std::optional<Order> get(int orderId) const; // rebuilt from the journal image
+    int driverOf(int orderId) const; // -1 when not assigned or unknown
+    std::vector<Order> live() const; // every non-terminal order, e.g. to requeue after replay
+    size_t size() const;
+
+    bool durable() const { return fd >= 0; }
+    uint64_t lastSequence() const;
+    // blocks until the journal is synced up to seq; false when the commit covering it
+    // failed (the records stay buffered and the commit is retried) or there is no journal
+    bool waitDurable(uint64_t seq);
+    bool snapshotNow(); // false when the snapshot or the commit before it failed
+
+    size_t replayedRecords() const { return replayed; }
+
+private:
+    // journal record, framed on disk as [crc32 of record][record]
+    struct Record {
+        uint64_t seq;
+        int64_t created;    // nanoseconds since epoch
+        double fare;
+        int32_t id, pickup, dropoff, passengerId, driverId;
+        uint8_t kind;       // PUT or STATUS
+        uint8_t status;
+        uint8_t pad[2];
+    };
+    enum : uint8_t { PUT = 1, STATUS = 2 };
+
+    Options opts;
+    mutable std::mutex mtx;
+    std::unordered_map<int, Record> orders; // seq unused; PUT image with the latest status
+    std::vector<char> pending;      // encoded records not yet written
+    uint64_t seq{0};                // last sequence handed out
+    uint64_t sinceSnapshot{0};
+    size_t replayed{0};
+
+    int fd{-1};
+    std::thread committer;
+    std::condition_variable commitCv, durableCv;
+    uint64_t durableSeq{0};
+    uint64_t snapshotSeq{0};        // upTo of the last snapshot written
+    uint64_t failedUpTo{0};         // upTo of the last commit whose write or sync failed
+    uint64_t failures{0};
+    bool stopping{false};
+    bool snapshotRequested{false};
+
+    void append(Record r);          // caller holds mtx
+    void apply(const Record &r);    // caller holds mtx (or is replaying)
+    static Record encode(const Order &o, int driverId);
+    static Order decode(const Record &r);
+    void replay();
+    void commitLoop();
+    bool writeOut(const std::vector<char> &buf);
+    bool writeSnapshot(const std::vector<Record> &recs, uint64_t upTo);
+    std::string journalPath() const { return opts.dir + "/orders.journal"; }
+    std::string snapshotPath() const { return opts.dir + "/orders.snapshot"; }
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Background thread that calls f every interval until stop(). stop() wakes a
+// sleeping thread at once and waits for a call in progress to finish. Owners
+// whose f reads their own members call stop() first thing in their destructor,
+// before those members go away.
+class PeriodicThread {
+public:
+    PeriodicThread() = default;
+    ~PeriodicThread(){ stop(); }
+    PeriodicThread(const PeriodicThread&) = delete;
+    PeriodicThread& operator=(const PeriodicThread&) = delete;
+
+    // no-op for a zero interval or when already running
+    void start(std::chrono::milliseconds interval, std::function<void()> f){
+        if(interval.count() <= 0 || thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            stopping = false;
+        }
+        thread = std::thread([this, interval, f]{
+            std::unique_lock<std::mutex> lk(mtx);
+            while(!cv.wait_for(lk, interval, [this]{ return stopping; })){
+                lk.unlock();
+                f();
+                lk.lock();
+            }
+        });
+    }
+
+    void stop(){
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        if(thread.joinable()) thread.join();
+    }
+
+private:
+    std::thread thread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping{false};
+};
@@ -0,0 +1,165 @@
+#include "Repositioner.h"
+#include "MinCostFlow.h"
+#include "../utils/Logger.h"
+#include "../utils/Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+Repositioner::Repositioner(const Graph &g, RepositionConfig c): Repositioner(g, nullptr, c) {}
+
+// zones and centres depend on topology only, so any version will do
+Repositioner::Repositioner(const LiveGraph &g, RepositionConfig c): Repositioner(*g.snapshot(), &g, c) {}
+
+Repositioner::Repositioner(const Graph &g, const LiveGraph *lg, RepositionConfig c)
+    : graph(lg ? nullptr : &g), live(lg), cfg(c), zones(g, std::max(1, c.zoneSize)) {
+    int zc = zones.cellCount();
+    arrivals.reset(new std::atomic<uint32_t>[zc]);
+    for(int z=0;z<zc;z++) arrivals[z].store(0, std::memory_order_relaxed);
+    level.assign(zc, 0.0);
+    trend.assign(zc, 0.0);
+    published = std::make_shared<const std::vector<double>>(zc, 0.0);
+
+    // centre: the member nearest the zone's centroid when coordinates are known,
+    // otherwise the zone's seed (its lowest node id)
+    centre.assign(zc, -1);
+    for(int u=0;u<g.n;u++) if(centre[zones.cell(u)] < 0) centre[zones.cell(u)] = u;
+    if(g.coords.size() == (size_t)g.n){
+        std::vector<double> lat(zc, 0.0), lon(zc, 0.0);
+        std::vector<int> count(zc, 0);
+        for(int u=0;u<g.n;u++){ int z = zones.cell(u); lat[z] += g.coords[u].lat; lon[z] += g.coords[u].lon; count[z]++; }
+        std::vector<double> best(zc, std::numeric_limits<double>::max());
+        for(int u=0;u<g.n;u++){
+            int z = zones.cell(u);
+            double dl = g.coords[u].lat - lat[z] / count[z], dn = g.coords[u].lon - lon[z] / count[z];
+            double d = dl * dl + dn * dn;
+            if(d < best[z]){ best[z] = d; centre[z] = u; }
+        }
+    }
+
+    ticker.start(cfg.tick, [this]{ tick(); });
+}
+
+Repositioner::~Repositioner(){
+    ticker.stop();
+}
+
+void Repositioner::track(const std::shared_ptr<Driver> &drv){
+    track(std::vector<std::shared_ptr<Driver>>{drv});
+}
+
+void Repositioner::track(const std::vector<std::shared_ptr<Driver>> &drvs){
+    fleet.update([&](Fleet::Map &f){
+        for(auto &d: drvs) if(d) f[d->id] = d;
+    });
+}
+
+void Repositioner::untrack(int driverId){
+    fleet.erase(driverId);
+}
+
+void Repositioner::orderSubmitted(int pickupNode){
+    int z = zones.cell(pickupNode);
+    if(z >= 0) arrivals[z].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<double> Repositioner::forecast() const {
+    return *std::atomic_load(&published);
+}
+
+std::vector<Relocation> Repositioner::tick(){
+    std::lock_guard<std::mutex> lg(tickMtx);
+    const int zc = zones.cellCount();
+
+    // close the bucket: Holt's linear smoothing per zone
+    auto f = std::make_shared<std::vector<double>>(zc, 0.0);
+    for(int z=0;z<zc;z++){
+        double c = arrivals[z].exchange(0, std::memory_order_relaxed);
+        if(!warm){
+            level[z] = c;
+        } else {
+            double prev = level[z];
+            level[z] = cfg.levelSmoothing * c + (1 - cfg.levelSmoothing) * (level[z] + trend[z]);
+            trend[z] = cfg.trendSmoothing * (level[z] - prev) + (1 - cfg.trendSmoothing) * trend[z];
+        }
+        (*f)[z] = std::max(0.0, level[z] + cfg.horizon * trend[z]);
+    }
+    warm = true;
+    double total = std::accumulate(f->begin(), f->end(), 0.0);
+    std::atomic_store(&published, std::shared_ptr<const std::vector<double>>(f));
+
+    // idle supply per zone: FIFO drivers with nothing to do and not already on the way somewhere
+    std::vector<std::vector<Driver*>> idle(zc);
+    auto drivers = fleet.snapshot();
+    int supply = 0;
+    for(auto &p: *drivers){
+        Driver *d = p.second.get();
+        if(d->pooling() || d->serving() || d->queued() > 0 || d->relocating()) continue;
+        int z = zones.cell(d->location.load());
+        if(z < 0) continue;
+        idle[z].push_back(d);
+        supply++;
+    }
+    if(supply == 0 || total <= 0 || cfg.maxMoves <= 0) return {};
+
+    // share the idle drivers out in proportion to the forecast (largest remainder)
+    std::vector<int> target(zc);
+    std::vector<std::pair<double,int>> rest;
+    int placed = 0;
+    for(int z=0;z<zc;z++){
+        double share = supply * (*f)[z] / total;
+        target[z] = (int)share;
+        placed += target[z];
+        rest.push_back({share - target[z], z});
+    }
+    std::sort(rest.begin(), rest.end(), [](const std::pair<double,int> &a, const std::pair<double,int> &b){ return a.first > b.first; });
+    for(int k=0;k<supply-placed;k++) target[rest[k].second]++;
+
+    std::vector<int> from, to;
+    for(int z=0;z<zc;z++){
+        if((int)idle[z].size() > target[z]) from.push_back(z);
+        else if((int)idle[z].size() < target[z]) to.push_back(z);
+    }
+    if(from.empty() || to.empty()) return {};
+
+    // transportation problem: source -> surplus zones -> deficit zones -> sink
+    std::vector<int> srcNodes, dstNodes;
+    for(int z: from) srcNodes.push_back(centre[z]);
+    for(int z: to) dstNodes.push_back(centre[z]);
+    auto pinned = live ? live->snapshot() : nullptr;
+    const Graph &g = pinned ? *pinned : *graph;
+    auto dist = g.distanceTable(srcNodes, dstNodes);
+    const int S = 0, T = 1, base = 2;
+    MinCostFlow mcf(base + (int)from.size() + (int)to.size());
+    for(size_t i=0;i<from.size();i++) mcf.addEdge(S, base + (int)i, (int)idle[from[i]].size() - target[from[i]], 0);
+    for(size_t j=0;j<to.size();j++) mcf.addEdge(base + (int)(from.size() + j), T, target[to[j]] - (int)idle[to[j]].size(), 0);
+    struct Lane { int edge, i, j; };
+    std::vector<Lane> lanes;
+    for(size_t i=0;i<from.size();i++){
+        for(size_t j=0;j<to.size();j++){
+            long long d = dist[i * to.size() + j];
+            if(d > cfg.maxDistance) continue;
+            int e = mcf.addEdge(base + (int)i, base + (int)(from.size() + j), supply, d);
+            lanes.push_back({e, (int)i, (int)j});
+        }
+    }
+    mcf.solve(S, T, cfg.maxMoves);
+
+    std::vector<Relocation> moves;
+    for(auto &l: lanes){
+        int k = mcf.flowOn(l.edge);
+        auto &pool = idle[from[l.i]];
+        for(;k>0 && !pool.empty();k--){
+            Driver *d = pool.back();
+            pool.pop_back();
+            d->relocate(centre[to[l.j]]);
+            moves.push_back({d->id, from[l.i], to[l.j], centre[to[l.j]]});
+        }
+    }
+    if(!moves.empty()){
+        Metrics::inc(Counter::RELOCATIONS, moves.size());
+        LOG_INFO("Repositioning: {} idle drivers moved toward forecast demand ({} idle)", moves.size(), supply);
+    }
+    return moves;
+}
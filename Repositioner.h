@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Graph.h"
+#include "LiveGraph.h"
+#include "GraphPartition.h"
+#include "../models/Driver.h"
+#include "../utils/PeriodicThread.h"
+#include "../utils/SnapshotMap.h"
+
+struct RepositionConfig {
+    int zoneSize = 256;                     // nodes per demand zone
+    std::chrono::milliseconds tick{30000};  // one demand bucket per tick; 0: call Repositioner::tick() yourself
+    double levelSmoothing = 0.3;            // weight of the newest bucket in a zone's demand level
+    double trendSmoothing = 0.1;            // weight of the newest level change in its trend
+    double horizon = 2;                     // forecast this many buckets ahead
+    int maxMoves = 32;                      // relocations per tick
+    long long maxDistance = 2000;           // longest relocation, zone centre to zone centre
+};
+
+struct Relocation {
+    int driverId;
+    int fromZone, toZone;
+    int node; // where the driver was sent
+};
+
+// Sends idle drivers to where the next orders are expected. Pickups are counted
+// per zone (lock-free, at intake); every tick closes one time bucket and folds
+// it into each zone's exponentially smoothed demand level and trend (Holt), so
+// the forecast decays old demand and follows a rising or falling neighbourhood.
+// Idle drivers are then shared out across zones in proportion to the forecast,
+// and a min-cost flow from zones with too many to zones with too few picks the
+// moves with the least total driving, up to maxMoves per tick.
+class Repositioner {
+public:
+    // g must outlive the repositioner (centre-to-centre distances are queried each tick)
+    explicit Repositioner(const Graph &g, RepositionConfig cfg = RepositionConfig{});
+    // each tick queries the latest traffic version
+    explicit Repositioner(const LiveGraph &g, RepositionConfig cfg = RepositionConfig{});
+    ~Repositioner();
+
+    void track(const std::shared_ptr<Driver> &drv);
+    void track(const std::vector<std::shared_ptr<Driver>> &drvs);
+    void untrack(int driverId);
+
+    // lock-free, callable from any thread
+    void orderSubmitted(int pickupNode);
+
+    // close the current bucket, update forecasts and relocate idle drivers;
+    // run by the tick thread. Returns the moves issued.
+    std::vector<Relocation> tick();
+
+    // expected orders per bucket in each zone, horizon buckets ahead
+    std::vector<double> forecast() const;
+    int zoneCount() const { return zones.cellCount(); }
+    int zoneOf(int node) const { return zones.cell(node); }
+    int zoneCentre(int zone) const { return centre[zone]; }
+    std::chrono::milliseconds tickInterval() const { return cfg.tick; }
+
+private:
+    const Graph *graph{nullptr};
+    const LiveGraph *live{nullptr};
+    RepositionConfig cfg;
+    GraphPartition zones;
+    std::vector<int> centre;                             // zone -> node drivers are sent to
+    std::unique_ptr<std::atomic<uint32_t>[]> arrivals;   // zone -> pickups in the open bucket
+
+    using Fleet = SnapshotMap<int, std::shared_ptr<Driver>>;
+    Fleet fleet;
+
+    // tick state, guarded by tickMtx
+    std::mutex tickMtx;
+    std::vector<double> level, trend;
+    bool warm{false};
+    std::shared_ptr<const std::vector<double>> published; // forecast, read via std::atomic_load
+
+    PeriodicThread ticker;
+
+    Repositioner(const Graph &topology, const LiveGraph *live, RepositionConfig cfg);
+};
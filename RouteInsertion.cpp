@@ -0,0 +1,101 @@
+#include "RouteInsertion.h"
+#include <vector>
+
+namespace routing {
+
+namespace {
+
+// per-point state of the route being evaluated, reused across calls on a thread
+struct RouteScan {
+    std::vector<long long> arrive; // route distance origin -> point
+    std::vector<int> load;         // passengers aboard when leaving the point
+    std::vector<int> ref;          // dropoff points: where the passenger's budget is counted from; -1 otherwise
+    std::vector<long long> slack;  // dropoff points: extra in-car distance still allowed
+
+    void scan(const RoutePlan &r){
+        const int m = (int)r.stops.size();
+        arrive.assign(m + 1, 0);
+        load.assign(m + 1, r.onboard);
+        ref.assign(m + 1, -1);
+        slack.assign(m + 1, 0);
+        for(int k=1;k<=m;k++){
+            const RouteStop &s = r.stops[k-1];
+            arrive[k] = arrive[k-1] + s.leg;
+            load[k] = load[k-1] + (s.pickup ? 1 : -1);
+            if(s.pickup) continue;
+            ref[k] = 0; // aboard at origin unless the pickup is still ahead
+            for(int q=1;q<k;q++) if(r.stops[q-1].pickup && r.stops[q-1].orderId == s.orderId) ref[k] = q;
+            slack[k] = s.budget - (arrive[k] - arrive[ref[k]]);
+        }
+    }
+
+    // points after `after` are pushed back by dP, and points after `dropAfter` by dD more
+    bool budgetsHold(int after, int dropAfter, long long dP, long long dD) const {
+        auto delay = [&](int x){ return x <= after ? 0 : x <= dropAfter ? dP : dP + dD; };
+        for(size_t k=1;k<ref.size();k++){
+            if(ref[k] < 0) continue;
+            long long extra = delay((int)k) - delay(ref[k]);
+            if(extra > 0 && extra > slack[k]) return false;
+        }
+        return true;
+    }
+};
+
+}
+
+Insertion bestInsertion(const RoutePlan &r, const long long *toPickup, const long long *toDropoff, long long direct){
+    Insertion best;
+    if(direct >= Graph::INF) return best;
+    thread_local RouteScan rs;
+    rs.scan(r);
+    const int m = (int)r.stops.size();
+    const PoolingLimits &lim = r.limits;
+    const long long budget = (long long)(lim.maxDetour * (double)direct);
+    auto legAfter = [&](int k){ return r.stops[k].leg; }; // leg into point k+1, k < m
+
+    for(int i=0;i<=m;i++){
+        if(rs.load[i] >= lim.capacity || toPickup[i] >= Graph::INF) continue;
+        if(lim.maxPickup > 0 && rs.arrive[i] + toPickup[i] > lim.maxPickup) continue;
+
+        // dropoff straight after the pickup
+        if(i == m || toDropoff[i+1] < Graph::INF){
+            long long add = toPickup[i] + direct + (i < m ? toDropoff[i+1] - legAfter(i) : 0);
+            if(add < best.cost && rs.budgetsHold(i, i, add, 0)) best = {i, i, add};
+        }
+        if(i == m || toPickup[i+1] >= Graph::INF) continue;
+
+        // with shortest-distance legs a dropoff detour is never negative, so the pickup detour bounds the total
+        long long dP = toPickup[i] + toPickup[i+1] - legAfter(i);
+        if(dP >= best.cost) continue;
+        for(int j=i+1;j<=m;j++){
+            if(rs.load[j] >= lim.capacity) break; // the new passenger is still aboard leaving j
+            long long ride = toPickup[i+1] + rs.arrive[j] - rs.arrive[i+1];
+            if(ride > budget) break;
+            if(toDropoff[j] >= Graph::INF) continue;
+            if(ride + toDropoff[j] > budget) continue;
+            long long dD = toDropoff[j] + (j < m ? toDropoff[j+1] - legAfter(j) : 0);
+            if(dP + dD < best.cost && rs.budgetsHold(i, j, dP, dD)) best = {i, j, dP + dD};
+        }
+    }
+    return best;
+}
+
+void insert(RoutePlan &r, const Insertion &ins, int orderId, int pickup, int dropoff,
+            const long long *toPickup, const long long *toDropoff, long long direct){
+    const int i = ins.pickupAfter, j = ins.dropoffAfter, m = (int)r.stops.size();
+    RouteStop p{orderId, pickup, true, toPickup[i], 0};
+    RouteStop d{orderId, dropoff, false, 0, (long long)(r.limits.maxDetour * (double)direct)};
+    if(i == j){
+        d.leg = direct;
+        if(i < m) r.stops[i].leg = toDropoff[i+1];
+    } else {
+        r.stops[i].leg = toPickup[i+1];
+        d.leg = toDropoff[j];
+        if(j < m) r.stops[j].leg = toDropoff[j+1];
+    }
+    // point k sits at stops[k-1], so "after point k" is index k; dropoff first keeps i valid
+    r.stops.insert(r.stops.begin() + j, d);
+    r.stops.insert(r.stops.begin() + i, p);
+}
+
+}
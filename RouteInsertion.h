@@ -0,0 +1,29 @@
+#pragma once
+#include "Graph.h"
+#include "../models/RoutePlan.h"
+
+// Where a new pickup/dropoff pair goes in a route. Route points are numbered
+// 0 = origin, k = stops[k-1]; each stop is placed right after a point.
+struct Insertion {
+    int pickupAfter = -1;
+    int dropoffAfter = -1;          // >= pickupAfter; equal means straight after the pickup
+    long long cost = Graph::INF;    // added route distance
+    bool valid() const { return pickupAfter >= 0; }
+};
+
+namespace routing {
+
+// Cheapest feasible insertion of a new order into r, or an invalid Insertion.
+// toPickup[k] / toDropoff[k] are road distances between route point k and the
+// new pickup / dropoff (roads are two-way, so one direction serves both);
+// direct is pickup -> dropoff. Existing legs are reused as they are, so only
+// these 2(m+1)+1 distances are queried per route of m stops.
+// Checks capacity, every passenger's detour budget and limits.maxPickup; pickup
+// positions whose own detour already exceeds the best cost are skipped.
+Insertion bestInsertion(const RoutePlan &r, const long long *toPickup, const long long *toDropoff, long long direct);
+
+// apply an insertion returned by bestInsertion for the same arrays
+void insert(RoutePlan &r, const Insertion &ins, int orderId, int pickup, int dropoff,
+            const long long *toPickup, const long long *toDropoff, long long direct);
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+struct PoolingLimits {
+    int capacity = 3;          // passengers in the car at once
+    double maxDetour = 1.5;    // in-car distance <= maxDetour * direct pickup -> dropoff distance
+    long long maxPickup = 0;   // route distance before a new pickup (0: no limit)
+};
+
+// one pickup or dropoff on a pooled driver's route
+struct RouteStop {
+    int orderId;
+    int node;
+    bool pickup;
+    long long leg;     // road distance from the previous stop, or from the plan's origin
+    long long budget;  // dropoffs: in-car distance still allowed, counted from origin when the
+                       // passenger is aboard there, else from the pickup
+};
+
+// Remaining route of a pooling driver. The driver is at, or already committed
+// to driving to, `origin`; the stops follow in order. Distances come from the
+// dispatcher's graph when stops are inserted and are not re-queried afterwards.
+struct RoutePlan {
+    int origin = -1;
+    std::vector<RouteStop> stops;
+    int onboard = 0;           // passengers in the car once origin is reached
+    PoolingLimits limits;
+    uint64_t version = 0;      // bumped by the driver on every change
+};
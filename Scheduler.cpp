@@ -1,66 +1,292 @@
 #include "Scheduler.h"
+#include "DriverIndex.h"
+#include "ScoringKernels.h"
+#include "RouteInsertion.h"
+#include "../models/Driver.h"
 #include "../utils/Logger.h"
 #include <queue>
 #include <limits>
 #include <algorithm>
 #include <cmath>
 
-// helper to compute driver->node distances
-static std::vector<std::vector<long long>> precomputeDistances(const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
-    int k = (int)drivers.size();
-    std::vector<std::vector<long long>> dist(k);
-    for(int i=0;i<k;i++) dist[i] = graph.dijkstra(drivers[i]->location.load());
-    return dist;
+// candidates considered per order when the dispatcher provides a spatial index
+static const int INDEX_CANDIDATES = 16;
+
+// the round's driver table from the dispatcher, or one built into `local` for direct callers
+static const DriverTable& tableFor(const DispatchContext &ctx, const std::vector<std::shared_ptr<Driver>>& drivers, DriverTable &local){
+    if(ctx.table && ctx.table->size() == drivers.size()) return *ctx.table;
+    local.build(drivers);
+    return local;
 }
 
-std::vector<std::pair<int,int>> NearestStrategy::assign(const std::vector<Order>& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
+// Candidate drivers of one order as parallel arrays the scoring kernels read directly.
+// An empty slot list means every driver, in table order (dist[i] belongs to drivers[i]).
+struct Candidates {
+    std::vector<int> slot;
+    std::vector<double> dist;
+    int size() const { return (int)dist.size(); }
+    int driverAt(int pos) const { return slot.empty() ? pos : slot[pos]; }
+};
+
+// helper to compute driver->pickup distances for every order.
+// With a spatial index only the k nearest indexed drivers are considered, otherwise every driver.
+static std::vector<Candidates> candidateDistances(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const DriverTable &table, const Graph &graph, const DispatchContext &ctx, int k, ThreadPool *pool=nullptr){
+    std::vector<Candidates> cand(orders.size());
+    std::vector<int> pickups;
+    for(auto &o: orders) pickups.push_back(o.pickup);
+    if(ctx.index == nullptr){
+        // roads are two-way, so pickup->driver rows equal driver->pickup and come out contiguous per order
+        auto dist = graph.distanceTable(pickups, table.location, pool);
+        for(size_t j=0;j<orders.size();j++){
+            cand[j].dist.assign(dist.begin() + j*drivers.size(), dist.begin() + (j+1)*drivers.size());
+        }
+        return cand;
+    }
+    for(size_t j=0;j<orders.size();j++){
+        for(int id: ctx.index->nearest(orders[j].pickup, k)){
+            auto it = ctx.driverSlot.find(id);
+            if(it != ctx.driverSlot.end()) cand[j].slot.push_back(it->second);
+        }
+    }
+    // only the candidate pairs, not a table over every candidate driver and pickup;
+    // an order with nothing indexed nearby among these drivers considers them all
+    std::vector<std::pair<int,int>> pairs;
+    for(size_t j=0;j<orders.size();j++){
+        auto &c = cand[j];
+        c.dist.resize(c.slot.empty() ? drivers.size() : c.slot.size());
+        for(int p=0;p<c.size();p++) pairs.push_back({table.location[c.driverAt(p)], pickups[j]});
+    }
+    auto dist = graph.pairDistances(pairs, pool);
+    size_t next = 0;
+    for(auto &c: cand){
+        for(auto &d: c.dist) d = (double)dist[next++];
+    }
+    return cand;
+}
+
+// per-order greedy pick: the lowest score under `limit` among the order's candidates
+static std::vector<std::pair<int,int>> assignGreedy(ScoreKind kind, double limit, const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx){
     std::vector<std::pair<int,int>> assignments;
     if(orders.empty() || drivers.empty()) return assignments;
-    auto dist = precomputeDistances(drivers, graph);
-    for(const auto &o: orders){
-        long long best = std::numeric_limits<long long>::max();
-        int bestIdx = -1;
-        for(int i=0;i<(int)drivers.size();i++){
-            long long d = dist[i][o.pickup];
-            if(d < best){
-                best = d; bestIdx = i;
-            }
-        }
-        if(bestIdx!=-1) assignments.push_back({o.id, bestIdx});
+    DriverTable local;
+    const DriverTable &table = tableFor(ctx, drivers, local);
+    auto cand = candidateDistances(orders, drivers, table, graph, ctx, INDEX_CANDIDATES);
+    for(size_t j=0;j<orders.size();j++){
+        const auto &c = cand[j];
+        int pos = scoring::bestCandidate(kind, c.dist.data(), c.slot.empty() ? nullptr : c.slot.data(), c.size(), table, limit);
+        if(pos != -1) assignments.push_back({orders[j].id, c.driverAt(pos)});
     }
     return assignments;
 }
 
-std::vector<std::pair<int,int>> LoadBalancedStrategy::assign(const std::vector<Order>& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
+std::vector<std::pair<int,int>> NearestStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
+    return assign(orders, drivers, graph, DispatchContext{});
+}
+
+std::vector<std::pair<int,int>> NearestStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx){
+    // no cap: an unreachable driver is still better than none
+    return assignGreedy(ScoreKind::DISTANCE, std::numeric_limits<double>::infinity(), orders, drivers, graph, ctx);
+}
+
+std::vector<std::pair<int,int>> LoadBalancedStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
+    return assign(orders, drivers, graph, DispatchContext{});
+}
+
+std::vector<std::pair<int,int>> LoadBalancedStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx){
+    // penalize by load
+    return assignGreedy(ScoreKind::LOAD_WEIGHTED, 1e18, orders, drivers, graph, ctx);
+}
+
+std::vector<std::pair<int,int>> RatingPriorityStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
+    return assign(orders, drivers, graph, DispatchContext{});
+}
+
+std::vector<std::pair<int,int>> RatingPriorityStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx){
+    // higher rating lowers score
+    return assignGreedy(ScoreKind::RATING_WEIGHTED, 1e18, orders, drivers, graph, ctx);
+}
+
+std::vector<std::pair<int,int>> BatchOptimalStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
+    return assign(orders, drivers, graph, DispatchContext{});
+}
+
+std::vector<std::pair<int,int>> BatchOptimalStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx){
     std::vector<std::pair<int,int>> assignments;
     if(orders.empty() || drivers.empty()) return assignments;
-    auto dist = precomputeDistances(drivers, graph);
-    for(const auto &o: orders){
-        double bestScore = 1e18;
-        int bestIdx = -1;
-        for(int i=0;i<(int)drivers.size();i++){
-            int load = drivers[i]->pending();
-            double score = dist[i][o.pickup] * (1.0 + load*0.5); // penalize by load
-            if(score < bestScore){ bestScore = score; bestIdx = i; }
+    const int M = (int)orders.size(), D = (int)drivers.size();
+    // the index is asked for extra drivers since its cell order only approximates road distance
+    DriverTable local;
+    auto rows = candidateDistances(orders, drivers, tableFor(ctx, drivers, local), graph, ctx, candidatesPerOrder * 2, pool.get());
+
+    // candidate lists: k nearest reachable drivers per order, (driver, cost)
+    std::vector<std::vector<std::pair<int,long long>>> cand(M);
+    long long maxCost = 1;
+    for(int j=0;j<M;j++){
+        auto &c = cand[j];
+        for(int p=0;p<rows[j].size();p++){
+            double d = rows[j].dist[p];
+            if(d < (double)Graph::INF) c.push_back({rows[j].driverAt(p), (long long)d}); // exact: distances stay far below 2^53
+        }
+        auto byCost = [](const std::pair<int,long long> &a, const std::pair<int,long long> &b){ return a.second < b.second; };
+        if((int)c.size() > candidatesPerOrder){
+            std::nth_element(c.begin(), c.begin() + candidatesPerOrder, c.end(), byCost);
+            c.resize(candidatesPerOrder);
+        }
+        for(auto &e: c) maxCost = std::max(maxCost, e.second);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + budget; // budget covers the solve, not the cost matrix
+
+    // Sparse Hungarian / successive shortest paths. Columns are the drivers [0, D) plus one
+    // private "stay queued" column per order [D, D+M). Leaving one order queued costs more
+    // than all M pickups together, so no rearrangement that serves one more order can cost
+    // more than it saves: the matching size is maximized first and cost second.
+    // Each order is added with one Dijkstra over reduced costs, so the solve is
+    // O(M * k log(M*k)) instead of depending on the fleet size.
+    const long long stayCost = (long long)M * maxCost + 1;
+    const int C = D + M;
+    std::vector<long long> rowPot(M, 0), colPot(C, 0);
+    std::vector<int> rowMatch(M, -1), colMatch(C, -1);
+    std::vector<long long> rowDist(M), colDist(C);
+    std::vector<int> rowSeen(M, -1), colSeen(C, -1), colPrev(C, -1);
+    std::vector<int> settledRows, settledCols;
+    using QE = std::pair<long long,int>; // dist, node (rows >= 0, columns encoded as ~col)
+    bool timedOut = false;
+    for(int r=0;r<M && !timedOut;r++){
+        if(std::chrono::steady_clock::now() > deadline){ timedOut = true; break; }
+        std::priority_queue<QE, std::vector<QE>, std::greater<QE>> pq;
+        settledRows.clear(); settledCols.clear();
+        rowDist[r] = 0; rowSeen[r] = r; pq.push({0, r});
+        int freeCol = -1;
+        long long freeDist = 0;
+        while(!pq.empty()){
+            auto [d,x] = pq.top(); pq.pop();
+            if(x < 0){
+                int c = ~x;
+                if(d != colDist[c]) continue;
+                settledCols.push_back(c);
+                if(colMatch[c] == -1){ freeCol = c; freeDist = d; break; }
+                int j = colMatch[c]; // matched edge is tight, reduced cost 0
+                if(rowSeen[j] != r || d < rowDist[j]){
+                    rowSeen[j] = r; rowDist[j] = d; pq.push({d, j});
+                }
+                continue;
+            }
+            int j = x;
+            if(d != rowDist[j]) continue;
+            settledRows.push_back(j);
+            auto relax = [&](int c, long long cost){
+                if(c == rowMatch[j]) return;
+                long long nd = d + cost + rowPot[j] - colPot[c];
+                if(colSeen[c] != r || nd < colDist[c]){
+                    colSeen[c] = r; colDist[c] = nd; colPrev[c] = j; pq.push({nd, ~c});
+                }
+            };
+            for(auto &e: cand[j]) relax(e.first, e.second);
+            relax(D + j, stayCost);
         }
-        if(bestIdx!=-1) assignments.push_back({o.id, bestIdx});
+        // potentials: pi += dist - freeDist on settled nodes keeps all reduced costs non-negative
+        for(int j: settledRows) if(rowDist[j] < freeDist) rowPot[j] += rowDist[j] - freeDist;
+        for(int c: settledCols) if(colDist[c] < freeDist) colPot[c] += colDist[c] - freeDist;
+        // flip the alternating path ending at freeCol
+        for(int c = freeCol; c != -1;){
+            int j = colPrev[c];
+            int next = rowMatch[j];
+            rowMatch[j] = c; colMatch[c] = j;
+            if(j == r) break;
+            c = next;
+        }
+    }
+
+    if(timedOut){
+        LOG_WARN("BatchOptimal: matching exceeded {}ms budget, using greedy matching", (long long)budget.count());
+        std::vector<std::pair<long long,std::pair<int,int>>> pairs; // cost, (order, driver)
+        for(int j=0;j<M;j++) for(auto &e: cand[j]) pairs.push_back({e.second, {j, e.first}});
+        std::sort(pairs.begin(), pairs.end());
+        std::vector<char> orderDone(M, 0), driverUsed(D, 0);
+        for(auto &p: pairs){
+            int j = p.second.first, i = p.second.second;
+            if(orderDone[j] || driverUsed[i]) continue;
+            orderDone[j] = driverUsed[i] = 1;
+            assignments.push_back({orders[j].id, i});
+        }
+        return assignments;
+    }
+
+    for(int j=0;j<M;j++){
+        if(rowMatch[j] >= 0 && rowMatch[j] < D) assignments.push_back({orders[j].id, rowMatch[j]});
     }
     return assignments;
 }
 
-std::vector<std::pair<int,int>> RatingPriorityStrategy::assign(const std::vector<Order>& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
+std::unordered_set<int> installRoutes(const std::unordered_map<int,RoutePlan>& routes, const std::vector<std::pair<int,int>>& assigns, const std::vector<std::shared_ptr<Driver>>& drivers){
+    std::unordered_set<int> installed, stale;
+    for(auto &pr: assigns){
+        auto it = routes.find(pr.second);
+        if(it == routes.end() || !installed.insert(pr.second).second) continue;
+        if(!drivers[pr.second]->updateRoute(it->second)){
+            LOG_WARN("Driver {} route changed during dispatch, its new orders stay queued", drivers[pr.second]->id);
+            stale.insert(pr.second);
+        }
+    }
+    return stale;
+}
+
+std::vector<std::pair<int,int>> PoolingStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph){
+    return assign(orders, drivers, graph, DispatchContext{});
+}
+
+std::vector<std::pair<int,int>> PoolingStrategy::assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx){
     std::vector<std::pair<int,int>> assignments;
     if(orders.empty() || drivers.empty()) return assignments;
-    auto dist = precomputeDistances(drivers, graph);
-    for(const auto &o: orders){
-        double bestScore = 1e18;
-        int bestIdx = -1;
-        for(int i=0;i<(int)drivers.size();i++){
-            double rating = drivers[i]->getRating();
-            double score = dist[i][o.pickup] / std::max(0.1, rating); // higher rating lowers score
-            if(score < bestScore){ bestScore = score; bestIdx = i; }
+    DriverTable local;
+    const DriverTable &table = tableFor(ctx, drivers, local);
+    std::vector<int> pooled;
+    for(size_t i=0;i<drivers.size();i++) if(table.available[i] && drivers[i]->pooling()) pooled.push_back((int)i);
+    if(pooled.empty()) return assignments;
+
+    // each route is read from its driver once and then edited locally for the rest of the round
+    std::unordered_map<int,RoutePlan> scratch;
+    auto &routes = ctx.routes ? *ctx.routes : scratch;
+    auto routeOf = [&](int slot) -> RoutePlan& {
+        auto it = routes.find(slot);
+        if(it == routes.end()) it = routes.emplace(slot, drivers[slot]->route()).first;
+        return it->second;
+    };
+
+    std::vector<int> cand, offset, targets;
+    for(auto &o: orders){
+        cand.clear();
+        if(ctx.index){
+            for(int id: ctx.index->nearest(o.pickup, INDEX_CANDIDATES)){
+                auto it = ctx.driverSlot.find(id);
+                if(it != ctx.driverSlot.end() && table.available[it->second] && drivers[it->second]->pooling()) cand.push_back(it->second);
+            }
+        }
+        if(cand.empty()) cand = pooled;
+
+        // one query for the whole order: {pickup, dropoff} x {dropoff, every candidate's route points}
+        targets.assign(1, o.dropoff);
+        offset.clear();
+        for(int slot: cand){
+            const RoutePlan &r = routeOf(slot);
+            offset.push_back((int)targets.size());
+            targets.push_back(r.origin);
+            for(auto &s: r.stops) targets.push_back(s.node);
+        }
+        auto dist = graph.distanceTable({o.pickup, o.dropoff}, targets);
+        const long long *toPickup = dist.data(), *toDropoff = dist.data() + targets.size();
+        long long direct = toPickup[0];
+
+        Insertion best;
+        int bestPos = -1;
+        for(size_t c=0;c<cand.size();c++){
+            Insertion ins = routing::bestInsertion(routeOf(cand[c]), toPickup + offset[c], toDropoff + offset[c], direct);
+            if(ins.valid() && ins.cost < best.cost){ best = ins; bestPos = (int)c; }
         }
-        if(bestIdx!=-1) assignments.push_back({o.id, bestIdx});
+        if(bestPos == -1) continue; // no route can take it this round: stays queued
+        routing::insert(routeOf(cand[bestPos]), best, o.id, o.pickup, o.dropoff, toPickup + offset[bestPos], toDropoff + offset[bestPos], direct);
+        assignments.push_back({o.id, cand[bestPos]});
     }
     return assignments;
 }
@@ -1,26 +1,86 @@
 #pragma once
 #include <vector>
 #include <utility>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
 #include "Order.h"
 #include "Graph.h"
+#include "DriverTable.h"
+#include "../models/RoutePlan.h"
+#include "../utils/ThreadPool.h"
+
+class Driver;
+class DriverIndex;
+
+// Per-round extras the dispatcher hands to strategies
+struct DispatchContext {
+    const DriverIndex *index = nullptr;          // spatial candidate index (optional)
+    std::unordered_map<int,int> driverSlot;      // driver id -> position in the drivers vector
+    const DriverTable *table = nullptr;          // state of the drivers vector, row per position (optional)
+    std::unordered_map<int,RoutePlan> *routes = nullptr; // out: updated routes of pooling drivers, by position
+};
+
+// Hands the routes edited during a round (DispatchContext::routes) to the drivers that got
+// orders in `assigns`. Returns the positions whose route moved on since it was read;
+// their assignments must be dropped so the orders stay queued.
+std::unordered_set<int> installRoutes(const std::unordered_map<int,RoutePlan>& routes, const std::vector<std::pair<int,int>>& assigns, const std::vector<std::shared_ptr<Driver>>& drivers);
 
 // Strategy interface
 struct AssignmentStrategy {
     virtual ~AssignmentStrategy() = default;
-    virtual std::vector<std::pair<int,int>> assign(const std::vector<Order>& orders, const std::vector<std::shared_ptr<class Driver>>& drivers, const Graph &graph) = 0;
+    virtual std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) = 0;
+    // context-aware entry point used by the Dispatcher; strategies that can use the index override it
+    virtual std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx){
+        (void)ctx;
+        return assign(orders, drivers, graph);
+    }
 };
 
 // Nearest: choose driver with smallest distance to pickup (ignores load and rating)
 struct NearestStrategy : public AssignmentStrategy {
-    std::vector<std::pair<int,int>> assign(const std::vector<Order>& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) override;
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) override;
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx) override;
 };
 
 // LoadBalanced: prefer drivers with fewer pending tasks (load-aware)
 struct LoadBalancedStrategy : public AssignmentStrategy {
-    std::vector<std::pair<int,int>> assign(const std::vector<Order>& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) override;
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) override;
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx) override;
 };
 
 // RatingPriority: favor higher-rated drivers (rating-aware)
 struct RatingPriorityStrategy : public AssignmentStrategy {
-    std::vector<std::pair<int,int>> assign(const std::vector<Order>& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) override;
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) override;
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx) override;
+};
+
+// BatchOptimal: min-cost matching of the whole batch, at most one order per driver per round.
+// Each order only considers its k nearest drivers; orders left unmatched stay queued.
+// Solved as a sparse Hungarian (successive shortest paths); if that overruns the
+// time budget the round falls back to a greedy cheapest-pair-first matching.
+struct BatchOptimalStrategy : public AssignmentStrategy {
+    int candidatesPerOrder;
+    std::chrono::milliseconds budget;   // matching solve time before falling back to greedy
+    // cost matrix workers (threads 0 = hardware concurrency, 1 = none), created once and
+    // shared by every round and zone using this strategy
+    std::shared_ptr<ThreadPool> pool;
+
+    BatchOptimalStrategy(int k=8, int threads=0, std::chrono::milliseconds budget_=std::chrono::milliseconds(20))
+        : candidatesPerOrder(k), budget(budget_), pool(threads == 1 ? nullptr : std::make_shared<ThreadPool>(threads)) {}
+
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) override;
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx) override;
+};
+
+// Pooling: each order goes into the route of a pooling driver (Driver::enablePooling)
+// where it adds the least road distance while every passenger stays within
+// capacity and detour limits; an idle pooling driver is just a route with no stops.
+// Drivers not pooling are never chosen. Orders are inserted one after another so
+// later orders see earlier insertions; the resulting routes go to ctx.routes for
+// the dispatcher to install with Driver::updateRoute.
+struct PoolingStrategy : public AssignmentStrategy {
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph) override;
+    std::vector<std::pair<int,int>> assign(const OrderSpan& orders, const std::vector<std::shared_ptr<Driver>>& drivers, const Graph &graph, const DispatchContext &ctx) override;
 };
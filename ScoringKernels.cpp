@@ -0,0 +1,92 @@
+#include "ScoringKernels.h"
+#include <algorithm>
+#include <limits>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace scoring {
+
+static inline double scoreOne(ScoreKind kind, double d, int row, const DriverTable &t){
+    if(!t.available[row]) return std::numeric_limits<double>::infinity();
+    switch(kind){
+    case ScoreKind::LOAD_WEIGHTED: return d * (1.0 + t.pending[row] * 0.5);
+    case ScoreKind::RATING_WEIGHTED: return d / std::max(0.1, t.rating[row]);
+    default: return d;
+    }
+}
+
+int bestCandidateScalar(ScoreKind kind, const double *dist, const int *slot, int n, const DriverTable &t, double limit){
+    double best = limit;
+    int bestPos = -1;
+    for(int i=0;i<n;i++){
+        double s = scoreOne(kind, dist[i], slot ? slot[i] : i, t);
+        if(s < best){ best = s; bestPos = i; }
+    }
+    return bestPos;
+}
+
+#ifdef __AVX2__
+int bestCandidateAvx2(ScoreKind kind, const double *dist, const int *slot, int n, const DriverTable &t, double limit){
+    const __m256d inf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    const __m256d half = _mm256_set1_pd(0.5), one = _mm256_set1_pd(1.0), floorRating = _mm256_set1_pd(0.1);
+    __m256d best = _mm256_set1_pd(limit);
+    __m256d bestPos = _mm256_set1_pd(-1.0);
+    __m256d pos = _mm256_setr_pd(0, 1, 2, 3);
+    const __m256d step = _mm256_set1_pd(4.0);
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256d d = _mm256_loadu_pd(dist + i);
+        __m128i avail, pend;
+        __m256d rating;
+        if(slot){
+            __m128i rows = _mm_loadu_si128((const __m128i*)(slot + i));
+            avail = _mm_i32gather_epi32(t.available.data(), rows, 4);
+            pend = kind == ScoreKind::LOAD_WEIGHTED ? _mm_i32gather_epi32(t.pending.data(), rows, 4) : _mm_setzero_si128();
+            rating = kind == ScoreKind::RATING_WEIGHTED ? _mm256_mask_i32gather_pd(one, t.rating.data(), rows, allLanes, 8) : one;
+        } else {
+            avail = _mm_loadu_si128((const __m128i*)(t.available.data() + i));
+            pend = kind == ScoreKind::LOAD_WEIGHTED ? _mm_loadu_si128((const __m128i*)(t.pending.data() + i)) : _mm_setzero_si128();
+            rating = kind == ScoreKind::RATING_WEIGHTED ? _mm256_loadu_pd(t.rating.data() + i) : one;
+        }
+        __m256d s = d;
+        if(kind == ScoreKind::LOAD_WEIGHTED){
+            s = _mm256_mul_pd(d, _mm256_add_pd(one, _mm256_mul_pd(_mm256_cvtepi32_pd(pend), half)));
+        } else if(kind == ScoreKind::RATING_WEIGHTED){
+            s = _mm256_div_pd(d, _mm256_max_pd(floorRating, rating));
+        }
+        __m256d unavailable = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(avail, _mm_setzero_si128())));
+        s = _mm256_blendv_pd(s, inf, unavailable);
+        __m256d lt = _mm256_cmp_pd(s, best, _CMP_LT_OQ); // strict: earlier lanes keep ties
+        best = _mm256_blendv_pd(best, s, lt);
+        bestPos = _mm256_blendv_pd(bestPos, pos, lt);
+        pos = _mm256_add_pd(pos, step);
+    }
+    // lanes hold the first minimum of their own residue class; pick the lowest score, then position
+    alignas(32) double lb[4], lp[4];
+    _mm256_store_pd(lb, best);
+    _mm256_store_pd(lp, bestPos);
+    double bestScore = limit;
+    int bestAt = -1;
+    for(int l=0;l<4;l++){
+        if(lp[l] < 0) continue;
+        if(lb[l] < bestScore || (lb[l] == bestScore && (int)lp[l] < bestAt)){ bestScore = lb[l]; bestAt = (int)lp[l]; }
+    }
+    for(; i<n; i++){
+        double s = scoreOne(kind, dist[i], slot ? slot[i] : i, t);
+        if(s < bestScore){ bestScore = s; bestAt = i; }
+    }
+    return bestAt;
+}
+#endif
+
+int bestCandidate(ScoreKind kind, const double *dist, const int *slot, int n, const DriverTable &t, double limit){
+#ifdef __AVX2__
+    return bestCandidateAvx2(kind, dist, slot, n, t, limit);
+#else
+    return bestCandidateScalar(kind, dist, slot, n, t, limit);
+#endif
+}
+
+}
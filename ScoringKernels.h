@@ -0,0 +1,24 @@
+#pragma once
+#include "DriverTable.h"
+
+// Candidate scoring for the greedy strategies; lower is better.
+//   DISTANCE         d
+//   LOAD_WEIGHTED    d * (1 + 0.5 * pending)
+//   RATING_WEIGHTED  d / max(0.1, rating)
+// Unavailable drivers never win.
+enum class ScoreKind { DISTANCE, LOAD_WEIGHTED, RATING_WEIGHTED };
+
+namespace scoring {
+
+// Position in [0, n) of the lowest-scoring candidate with score < limit, or -1.
+// Candidate i is table row slot[i], or row i when slot is null (dense).
+// Ties go to the lowest position, matching a plain first-minimum loop.
+// Uses AVX2 when the build targets it (-mavx2), otherwise the scalar kernel.
+int bestCandidate(ScoreKind kind, const double *dist, const int *slot, int n, const DriverTable &t, double limit);
+
+int bestCandidateScalar(ScoreKind kind, const double *dist, const int *slot, int n, const DriverTable &t, double limit);
+#ifdef __AVX2__
+int bestCandidateAvx2(ScoreKind kind, const double *dist, const int *slot, int n, const DriverTable &t, double limit);
+#endif
+
+}
@@ -0,0 +1,85 @@
+#include "SearchWorkspace.h"
+#include <memory>
+#include <algorithm>
+
+void RadixHeap::clear(){
+    for(auto &b: buckets) b.clear();
+    last = 0;
+    count = 0;
+}
+
+void RadixHeap::push(long long key, int v){
+    buckets[bucketOf((uint64_t)key, last)].push_back({(uint64_t)key, v});
+    count++;
+}
+
+std::pair<long long,int> RadixHeap::pop(){
+    if(buckets[0].empty()){
+        int i = 1;
+        while(buckets[i].empty()) i++;
+        // new minimum becomes the reference key; everything in bucket i moves to a lower bucket
+        uint64_t m = buckets[i][0].first;
+        for(auto &e: buckets[i]) if(e.first < m) m = e.first;
+        last = m;
+        for(auto &e: buckets[i]) buckets[bucketOf(e.first, last)].push_back(e);
+        buckets[i].clear();
+    }
+    auto e = buckets[0].back();
+    buckets[0].pop_back();
+    count--;
+    return {(long long)e.first, e.second};
+}
+
+SearchWorkspace::SearchWorkspace(int n_): n(n_), dist(n_, Graph::INF), seen(n_, 0), target(n_, 0) {}
+
+SearchWorkspace& SearchWorkspace::local(int n){
+    thread_local std::unique_ptr<SearchWorkspace> ws;
+    if(!ws || ws->n != n) ws.reset(new SearchWorkspace(n));
+    return *ws;
+}
+
+void SearchWorkspace::nextStamp(){
+    if(++stamp == 0){
+        // wrapped around: old stamps could alias, clear once every 2^32 searches
+        std::fill(seen.begin(), seen.end(), 0);
+        std::fill(target.begin(), target.end(), 0);
+        stamp = 1;
+    }
+}
+
+void SearchWorkspace::distances(const CsrGraph &g, int src, const std::vector<int>& targets, long long *out){
+    for(size_t j=0;j<targets.size();j++) out[j] = Graph::INF;
+    if(src<0 || src>=n) return;
+    nextStamp();
+
+    int remaining = 0;
+    for(int t: targets){
+        if(t>=0 && t<n && target[t] != stamp){ target[t] = stamp; remaining++; }
+    }
+
+    heap.clear();
+    dist[src] = 0; seen[src] = stamp;
+    heap.push(0, src);
+    while(!heap.empty() && remaining > 0){
+        auto [d,u] = heap.pop();
+        if(d != dist[u]) continue;
+        if(target[u] == stamp){
+            target[u] = 0; // settled
+            remaining--;
+        }
+        for(int k=g.offsets[u];k<g.offsets[u+1];k++){
+            int v = g.targets[k];
+            long long nd = d + g.weights[k];
+            if(seen[v] != stamp || nd < dist[v]){
+                seen[v] = stamp;
+                dist[v] = nd;
+                heap.push(nd, v);
+            }
+        }
+    }
+
+    for(size_t j=0;j<targets.size();j++){
+        int t = targets[j];
+        if(t>=0 && t<n && seen[t] == stamp) out[j] = dist[t];
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include "Graph.h"
+#include "CsrGraph.h"
+
+// Monotone priority queue for non-negative integer keys. Buckets keep their
+// capacity across searches, so a warmed-up heap does not allocate.
+class RadixHeap {
+public:
+    bool empty() const { return count == 0; }
+    void clear();
+    void push(long long key, int v);
+    std::pair<long long,int> pop(); // smallest key; keys pushed later must be >= it
+
+private:
+    static const int BUCKETS = 65;
+    std::vector<std::pair<uint64_t,int>> buckets[BUCKETS];
+    uint64_t last{0};
+    size_t count{0};
+
+    static int bucketOf(uint64_t key, uint64_t last){
+        return key == last ? 0 : 64 - __builtin_clzll(key ^ last);
+    }
+};
+
+// Per-thread Dijkstra state over a CsrGraph. Distances are invalidated by
+// bumping a timestamp instead of refilling the arrays, and a search stops as
+// soon as every requested target is settled.
+class SearchWorkspace {
+public:
+    explicit SearchWorkspace(int n);
+
+    // the calling thread's workspace, resized for an n-node graph
+    static SearchWorkspace& local(int n);
+
+    // out[j] = distance from src to targets[j] (Graph::INF if unreachable)
+    void distances(const CsrGraph &g, int src, const std::vector<int>& targets, long long *out);
+
+private:
+    int n;
+    std::vector<long long> dist;
+    std::vector<uint32_t> seen;    // dist[v] is valid when seen[v] == stamp
+    std::vector<uint32_t> target;  // v is a pending target when target[v] == stamp
+    uint32_t stamp{0};
+    RadixHeap heap;
+
+    void nextStamp();
+};
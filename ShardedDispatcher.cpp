@@ -0,0 +1,313 @@
+#include "ShardedDispatcher.h"
+#include "../utils/Logger.h"
+#include "../utils/Metrics.h"
+#include <atomic>
+
+ShardedDispatcher::ShardedDispatcher(const Graph &g, int zoneCount, int threads, int borderCandidates_)
+    : zones(GraphPartition::intoParts(g, zoneCount)),
+      borderNode(g.n, 0), index(g), pool(threads), borderCandidates(std::max(1, borderCandidates_)) {
+    for(int z=0;z<zones.cellCount();z++) shards.push_back(std::make_unique<Shard>());
+    if(zones.cellCount() != zoneCount) LOG_WARN("Sharded dispatcher: {} zones requested, {} built", zoneCount, zones.cellCount());
+    for(int u=0;u<g.n;u++){
+        g.forEachNeighbour(u, [&](int v, int){
+            if(zones.cell(v) != zones.cell(u)) borderNode[u] = 1;
+        });
+    }
+    LOG_INFO("Sharded dispatcher: {} zones on {} threads", zones.cellCount(), pool.size());
+}
+
+ShardedDispatcher::~ShardedDispatcher(){
+    std::vector<int> ids;
+    {
+        std::lock_guard<std::mutex> lg(registryMtx);
+        for(auto &p: registry) ids.push_back(p.first);
+    }
+    for(int id: ids) unregisterDriver(id);
+}
+
+void ShardedDispatcher::registerDriver(std::shared_ptr<Driver> drv, bool startWorker){
+    int z = zoneOf(drv->location.load());
+    if(z < 0) z = 0;
+    drv->setListener(this);
+    Member m{drv, std::make_shared<std::atomic<uint64_t>>(0)};
+    int old = -1;
+    {
+        std::lock_guard<std::mutex> lg(registryMtx);
+        auto it = registry.find(drv->id);
+        if(it == registry.end()) Metrics::addGauge(Gauge::DRIVERS_REGISTERED, 1);
+        else old = it->second.zone;
+        registry[drv->id] = Registered{m, z};
+    }
+    if(old >= 0){
+        std::lock_guard<std::mutex> lg(shards[old]->driversMtx);
+        shards[old]->drivers.erase(drv->id);
+    }
+    {
+        std::lock_guard<std::mutex> lg(shards[z]->driversMtx);
+        shards[z]->drivers[drv->id] = m;
+    }
+    index.update(drv->id, drv->location.load());
+    if(startWorker) drv->start();
+    LOG_INFO("Registered Driver {} in zone {}", drv->id, z);
+}
+
+void ShardedDispatcher::unregisterDriver(int id){
+    std::shared_ptr<Driver> drv;
+    int z;
+    {
+        std::lock_guard<std::mutex> lg(registryMtx);
+        auto it = registry.find(id);
+        if(it == registry.end()) return;
+        drv = it->second.member.driver;
+        z = it->second.zone;
+        registry.erase(it);
+        Metrics::addGauge(Gauge::DRIVERS_REGISTERED, -1);
+    }
+    {
+        std::lock_guard<std::mutex> lg(shards[z]->driversMtx);
+        shards[z]->drivers.erase(id);
+    }
+    index.remove(id);
+    drv->stop();
+    drv->setListener(nullptr);
+    LOG_INFO("Unregistered Driver {}", id);
+}
+
+void ShardedDispatcher::submitOrder(const Order &o){
+    InboxEvent e{InboxEvent::SUBMIT};
+    e.order = OrderPool::instance().acquire(o);
+    if(!e.order){
+        Metrics::inc(Counter::ORDERS_REJECTED); // acquire() logged it
+        return;
+    }
+    int z = zoneOf(o.pickup);
+    if(z < 0) z = 0;
+    {
+        std::lock_guard<std::mutex> lg(registryMtx);
+        orderZone[o.id] = z;
+    }
+    store.put(o);
+    e.orderId = o.id;
+    shards[z]->inbox.push(std::move(e));
+    Metrics::inc(Counter::ORDERS_SUBMITTED);
+}
+
+void ShardedDispatcher::cancelOrder(int orderId){
+    int z;
+    {
+        std::lock_guard<std::mutex> lg(registryMtx);
+        auto it = orderZone.find(orderId);
+        if(it == orderZone.end()){
+            LOG_INFO("Order {} not found for cancellation.", orderId);
+            return;
+        }
+        z = it->second;
+    }
+    InboxEvent e{InboxEvent::CANCEL};
+    e.orderId = orderId;
+    shards[z]->inbox.push(std::move(e));
+}
+
+void ShardedDispatcher::notifyOrderCancelled(int orderId, int driverId, PooledOrder order){
+    int z = 0;
+    {
+        std::lock_guard<std::mutex> lg(registryMtx);
+        auto it = orderZone.find(orderId);
+        if(it != orderZone.end()) z = it->second;
+    }
+    LOG_INFO("Zone {} received cancellation for Order {} from Driver {}", z, orderId, driverId);
+    InboxEvent e{InboxEvent::DRIVER_CANCELLED};
+    e.orderId = orderId;
+    e.order = std::move(order);
+    shards[z]->inbox.push(std::move(e));
+}
+
+void ShardedDispatcher::notifyOrderCompleted(int orderId, int driverId, int rating){
+    std::shared_ptr<Driver> drv;
+    {
+        std::lock_guard<std::mutex> lg(registryMtx);
+        orderZone.erase(orderId);
+        auto it = registry.find(driverId);
+        store.transition(orderId, OrderStatus::COMPLETED, driverId);
+        if(it != registry.end()) drv = it->second.member.driver;
+    }
+    if(drv) drv->addRating(rating);
+    LOG_INFO("Order {} completed by Driver {}. Rating={}", orderId, driverId, rating);
+}
+
+void ShardedDispatcher::notifyOrderPickedUp(int orderId, int driverId){
+    store.transition(orderId, OrderStatus::IN_PROGRESS, driverId);
+}
+
+void ShardedDispatcher::notifyDriverMoved(int driverId, int node){
+    index.update(driverId, node);
+    int to = zoneOf(node);
+    if(to < 0) return;
+    Member m;
+    int from;
+    {
+        std::lock_guard<std::mutex> lg(registryMtx);
+        auto it = registry.find(driverId);
+        if(it == registry.end() || it->second.zone == to) return;
+        m = it->second.member;
+        from = it->second.zone;
+        it->second.zone = to;
+    }
+    // hand the driver over to its new zone, claim included; the two locks are never held together
+    {
+        std::lock_guard<std::mutex> lg(shards[from]->driversMtx);
+        shards[from]->drivers.erase(driverId);
+    }
+    {
+        std::lock_guard<std::mutex> lg(shards[to]->driversMtx);
+        shards[to]->drivers[driverId] = m;
+    }
+}
+
+void ShardedDispatcher::setStrategy(std::shared_ptr<AssignmentStrategy> strat){
+    std::atomic_store(&strategy, strat);
+    LOG_INFO("Strategy updated.");
+}
+
+size_t ShardedDispatcher::queuedOrders(int zone){
+    std::lock_guard<std::mutex> lg(shards[zone]->dispatchMtx);
+    drainInbox(*shards[zone]);
+    return shards[zone]->book.size();
+}
+
+void ShardedDispatcher::drainInbox(Shard &s){
+    while(auto e = s.inbox.pop()){
+        switch(e->kind){
+        case InboxEvent::SUBMIT:
+            s.book.insert(std::move(e->order));
+            break;
+        case InboxEvent::CANCEL:
+            if(s.book.erase(e->orderId)){
+                {
+                    std::lock_guard<std::mutex> lg(registryMtx);
+                    orderZone.erase(e->orderId);
+                }
+                LOG_INFO("Passenger cancelled Order {}", e->orderId);
+                store.transition(e->orderId, OrderStatus::CANCELLED);
+                Metrics::inc(Counter::ORDERS_CANCELLED);
+            }
+            break;
+        case InboxEvent::DRIVER_CANCELLED: {
+            if(!e->order){
+                // the driver no longer held it: rebuild from the journal
+                auto stored = store.get(e->orderId);
+                if(!stored) break;
+                e->order = OrderPool::instance().acquire(*stored);
+                if(!e->order) break;
+            }
+            e->order->status = OrderStatus::QUEUED;
+            store.transition(e->orderId, OrderStatus::QUEUED);
+            s.book.insert(std::move(e->order));
+            break;
+        }
+        }
+    }
+}
+
+int ShardedDispatcher::runDispatch(const Graph &g){
+    std::vector<int> assigned(shards.size(), 0);
+    std::vector<std::function<void()>> jobs;
+    uint64_t r = ++round;
+    for(int z=0;z<(int)shards.size();z++){
+        jobs.push_back([this, z, r, &g, &assigned]{ assigned[z] = dispatchZone(z, g, r); });
+    }
+    pool.run(std::move(jobs));
+    int total = 0;
+    for(int a: assigned) total += a;
+    Metrics::inc(Counter::DISPATCH_ROUNDS);
+    Metrics::inc(Counter::ASSIGNMENTS, total);
+    Metrics::record(Histogram::ASSIGNMENTS_PER_ROUND, total);
+    return total;
+}
+
+// the first zone to assign a driver in a round owns it for the rest of that round
+bool ShardedDispatcher::claim(std::atomic<uint64_t> &stamp, uint64_t r, int z) const {
+    const uint64_t base = r * shards.size(), mine = base + z;
+    uint64_t cur = stamp.load();
+    while(cur < base){
+        if(stamp.compare_exchange_weak(cur, mine)) return true;
+    }
+    return cur == mine;
+}
+
+int ShardedDispatcher::dispatchZone(int z, const Graph &g, uint64_t r){
+    Shard &s = *shards[z];
+    std::lock_guard<std::mutex> lg(s.dispatchMtx);
+    METRICS_TIMER(Histogram::DISPATCH_LOCK_HOLD_NS);
+    drainInbox(s);
+    auto strat = std::atomic_load(&strategy);
+    if(!strat || s.book.empty()) return 0;
+
+    auto batch = s.book.snapshot();
+
+    // candidate drivers: own zone, plus the drivers nearest to each border pickup
+    std::vector<std::shared_ptr<Driver>> drvVec;
+    std::vector<std::shared_ptr<std::atomic<uint64_t>>> claims; // parallel to drvVec
+    DispatchContext ctx;
+    ctx.index = &index;
+    auto add = [&](int id, const Member &m){
+        if(ctx.driverSlot.emplace(id, (int)drvVec.size()).second){
+            drvVec.push_back(m.driver);
+            claims.push_back(m.claim);
+        }
+    };
+    {
+        std::lock_guard<std::mutex> dl(s.driversMtx);
+        for(auto &p: s.drivers) add(p.first, p.second);
+    }
+    std::vector<int> nearby;
+    for(auto &o: batch){
+        if(o.pickup<0 || o.pickup>=(int)borderNode.size() || !borderNode[o.pickup]) continue;
+        for(int id: index.nearest(o.pickup, borderCandidates)) if(!ctx.driverSlot.count(id)) nearby.push_back(id);
+    }
+    if(!nearby.empty()){
+        std::lock_guard<std::mutex> rl(registryMtx);
+        for(int id: nearby){
+            auto it = registry.find(id);
+            if(it != registry.end()) add(id, it->second.member);
+        }
+    }
+    if(drvVec.empty()) return 0;
+    s.table.build(drvVec);
+    ctx.table = &s.table;
+    std::unordered_map<int,RoutePlan> routes;
+    ctx.routes = &routes;
+
+    std::vector<std::pair<int,int>> assigns;
+    {
+        METRICS_TIMER(Histogram::ASSIGN_NS);
+        assigns = strat->assign(batch, drvVec, g, ctx);
+    }
+    // a driver near a border can be in two zones' rounds: only the zone that claims
+    // it first assigns to it, the rest of this zone's picks for it stay queued
+    std::vector<std::pair<int,int>> owned;
+    std::unordered_map<int,RoutePlan> ownedRoutes;
+    for(auto &pr: assigns){
+        if(pr.second<0 || pr.second>=(int)drvVec.size() || !claim(*claims[pr.second], r, z)) continue;
+        owned.push_back(pr);
+        auto rt = routes.find(pr.second);
+        if(rt != routes.end()) ownedRoutes.emplace(pr.second, std::move(rt->second));
+    }
+    assigns.swap(owned);
+    auto stale = installRoutes(ownedRoutes, assigns, drvVec);
+    int done = 0;
+    for(auto &pr: assigns){
+        if(stale.count(pr.second)) continue;
+        Order *o = s.book.find(pr.first);
+        if(!o) continue;
+        o->status = OrderStatus::ASSIGNED;
+        store.transition(o->id, OrderStatus::ASSIGNED, drvVec[pr.second]->id);
+        LOG_INFO("Zone {}: Assigned Order {} -> Driver {}", z, pr.first, drvVec[pr.second]->id);
+        Metrics::recordSince(Histogram::QUEUE_WAIT_NS, o->created);
+        PooledOrder taken = s.book.take(pr.first);
+        if(ownedRoutes.count(pr.second)) drvVec[pr.second]->carryOrder(std::move(taken));
+        else drvVec[pr.second]->assignOrder(std::move(taken));
+        done++;
+    }
+    return done;
+}
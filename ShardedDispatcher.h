@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include "models/Order.h"
+#include "models/Driver.h"
+#include "core/Graph.h"
+#include "core/LiveGraph.h"
+#include "core/Scheduler.h"
+#include "core/GraphPartition.h"
+#include "core/DriverIndex.h"
+#include "core/OrderBook.h"
+#include "core/OrderStore.h"
+#include "../utils/MpscQueue.h"
+#include "../utils/ThreadPool.h"
+
+// Dispatcher split by geography. The graph is partitioned into zones; each
+// zone owns its drivers, order book and event inbox, and all zones run their
+// dispatch round concurrently on a thread pool. An order whose pickup sits on a
+// zone border also sees the borderCandidates drivers nearest to its pickup
+// (from the spatial index), wherever they are registered; a driver offered to
+// several zones goes to whichever claims it first in that round, and the other
+// zones keep their orders queued for the next one.
+class ShardedDispatcher : public DriverListener {
+public:
+    // zones is a target: the partition merges fragments down to it, and
+    // zoneCount() reports what was built (fewer only on tiny graphs)
+    ShardedDispatcher(const Graph &g, int zones, int threads=0, int borderCandidates=8);
+    ~ShardedDispatcher();
+
+    void registerDriver(std::shared_ptr<Driver> drv, bool startWorker=true);
+    void unregisterDriver(int id);
+
+    // lock-free: events go to the owning zone's inbox
+    void submitOrder(const Order &o);
+    void cancelOrder(int orderId);
+    void notifyOrderCancelled(int orderId, int driverId, PooledOrder order) override;
+    void notifyOrderCompleted(int orderId, int driverId, int rating) override;
+    void notifyDriverMoved(int driverId, int node) override;
+    void notifyOrderPickedUp(int orderId, int driverId) override;
+
+    void setStrategy(std::shared_ptr<AssignmentStrategy> strat); // shared by all zones, must be stateless
+
+    // one round in every zone, in parallel; returns the number of assignments
+    int runDispatch(const Graph &g);
+    int runDispatch(const LiveGraph &g){ return runDispatch(*g.snapshot()); }
+
+    int zoneCount() const { return (int)shards.size(); }
+    int zoneOf(int node) const { return zones.cell(node); }
+    size_t queuedOrders(int zone);
+
+private:
+    struct InboxEvent {
+        enum Kind { SUBMIT, CANCEL, DRIVER_CANCELLED } kind;
+        explicit InboxEvent(Kind k): kind(k) {}
+        PooledOrder order; // SUBMIT, and DRIVER_CANCELLED when the driver handed it back
+        int orderId{0};
+    };
+
+    // a driver and its claim stamp: round * zones + the zone that owns it this round
+    struct Member {
+        std::shared_ptr<Driver> driver;
+        std::shared_ptr<std::atomic<uint64_t>> claim;
+    };
+
+    struct Registered {
+        Member member;
+        int zone;
+    };
+
+    struct Shard {
+        std::mutex driversMtx;                          // short holds only, never nested
+        std::map<int, Member> drivers;
+        std::mutex dispatchMtx;                         // held by the zone's dispatch round
+        OrderBook book;
+        DriverTable table;                              // candidate state for the round, rebuilt under dispatchMtx
+        MpscQueue<InboxEvent> inbox;
+    };
+
+    GraphPartition zones;
+    std::vector<char> borderNode;                       // pickup here => cross-border order
+    std::vector<std::unique_ptr<Shard>> shards;
+    DriverIndex index;
+    ThreadPool pool;
+    const int borderCandidates;
+
+    std::mutex registryMtx;
+    std::unordered_map<int, Registered> registry;
+    std::unordered_map<int, int> orderZone;             // order id -> zone it was routed to
+    OrderStore store;                                   // journal images, for an order a cancelling driver no longer held
+    std::shared_ptr<AssignmentStrategy> strategy;
+    std::atomic<uint64_t> round{0};
+
+    int dispatchZone(int z, const Graph &g, uint64_t round);
+    bool claim(std::atomic<uint64_t> &stamp, uint64_t round, int z) const;
+    void drainInbox(Shard &s);
+};
@@ -0,0 +1,176 @@
+#include "Simulation.h"
+#include "core/Dispatcher.h"
+#include "../utils/Logger.h"
+#include <thread>
+
+Simulation::Simulation(Dispatcher &d, const Graph &g, Config cfg_)
+    : dispatcher(d), graph(g), cfg(cfg_), rng(cfg_.seed) {
+    push(0, SimEventType::DISPATCH_TICK, -1, -1);
+}
+
+void Simulation::addDriver(std::shared_ptr<Driver> drv){
+    if(drv->pooling()){
+        // routes with several passengers are not simulated; only takeNext() trips are
+        LOG_WARN("Simulation: Driver {} pools orders, which is not simulated; not added", drv->id);
+        return;
+    }
+    dispatcher.registerDriver(drv, false);
+    drivers[drv->id].drv = drv;
+}
+
+void Simulation::scheduleOrder(double at, const Order &o){
+    pendingOrders.emplace(o.id, o);
+    push(at, SimEventType::ORDER_ARRIVAL, -1, o.id);
+}
+
+void Simulation::scheduleCancel(double at, int orderId){
+    push(at, SimEventType::PASSENGER_CANCEL, -1, orderId);
+}
+
+void Simulation::scheduleDriver(double at, std::shared_ptr<Driver> drv){
+    joining[drv->id] = drv;
+    push(at, SimEventType::DRIVER_JOIN, drv->id, -1);
+}
+
+void Simulation::scheduleMove(double at, int driverId, int node){
+    push(at, SimEventType::DRIVER_MOVE, driverId, -1, node);
+}
+
+void Simulation::scheduleLeave(double at, int driverId){
+    push(at, SimEventType::DRIVER_LEAVE, driverId, -1);
+}
+
+void Simulation::push(double at, SimEventType type, int driverId, int orderId, int node){
+    events.push(SimEvent{at, nextSeq++, type, driverId, orderId, node});
+}
+
+double Simulation::travelTime(int from, int to) const {
+    long long d = graph.distanceTable({from}, {to})[0];
+    if(d >= Graph::INF) return 0; // unreachable: teleport rather than stall the driver forever
+    return d / cfg.speed;
+}
+
+void Simulation::run(double until){
+    const double from = clock;
+    const auto wallFrom = std::chrono::steady_clock::now();
+    while(!events.empty() && events.top().time <= until){
+        SimEvent e = events.top(); events.pop();
+        if(cfg.pace > 0){
+            std::this_thread::sleep_until(wallFrom + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>((e.time - from) / cfg.pace)));
+        }
+        clock = e.time;
+        handle(e);
+        st.eventsProcessed++;
+    }
+    clock = until;
+}
+
+bool Simulation::settled() const {
+    if(!pendingOrders.empty() || st.queued > 0) return false;
+    for(auto &p: drivers) if(p.second.busy) return false;
+    return true;
+}
+
+// pick up the driver's next assigned order, if idle
+void Simulation::startNext(SimDriver &sd){
+    if(sd.busy) return;
+    auto next = sd.drv->takeNext();
+    if(!next) return;
+    sd.busy = true;
+    sd.current = std::move(next);
+    sd.legStart = clock;
+    push(clock + travelTime(sd.drv->location.load(), sd.current->pickup), SimEventType::ARRIVE_PICKUP, sd.drv->id, sd.current->id);
+}
+
+void Simulation::handle(const SimEvent &e){
+    switch(e.type){
+    case SimEventType::ORDER_ARRIVAL: {
+        auto it = pendingOrders.find(e.orderId);
+        if(it == pendingOrders.end()) return;
+        arrivalTime[e.orderId] = clock;
+        dispatcher.submitOrder(it->second);
+        pendingOrders.erase(it);
+        st.ordersSubmitted++;
+        break;
+    }
+    case SimEventType::PASSENGER_CANCEL:
+        dispatcher.cancelOrder(e.orderId); // counted once the next round applies it
+        break;
+    case SimEventType::DISPATCH_TICK: {
+        DispatchRound r = dispatcher.runDispatch(graph);
+        st.queued = r.remaining;
+        st.passengerCancellations += r.cancelled;
+        st.dispatchRounds++;
+        for(auto &p: drivers) startNext(p.second);
+        push(clock + cfg.dispatchInterval, SimEventType::DISPATCH_TICK, -1, -1);
+        break;
+    }
+    case SimEventType::ARRIVE_PICKUP: {
+        auto it = drivers.find(e.driverId);
+        if(it == drivers.end() || !it->second.current || it->second.current->id != e.orderId) return; // left meanwhile
+        auto &sd = it->second;
+        sd.drv->setLocation(sd.current->pickup);
+        // picked up first, as the driver worker does; the cancel roll comes after
+        dispatcher.notifyOrderPickedUp(sd.current->id, e.driverId);
+        std::uniform_int_distribution<int> chance(0, 99);
+        if(chance(rng) < cfg.cancelPercent){
+            st.driverCancellations++;
+            st.busyTime += clock - sd.legStart;
+            sd.busy = false;
+            int orderId = sd.current->id;
+            dispatcher.notifyOrderCancelled(orderId, e.driverId, std::move(sd.current));
+            startNext(sd);
+            break;
+        }
+        st.totalPickupTime += clock - arrivalTime[sd.current->id];
+        sd.pickedAt = clock;
+        push(clock + travelTime(sd.current->pickup, sd.current->dropoff), SimEventType::ARRIVE_DROPOFF, e.driverId, sd.current->id);
+        break;
+    }
+    case SimEventType::ARRIVE_DROPOFF: {
+        auto it = drivers.find(e.driverId);
+        if(it == drivers.end() || !it->second.current || it->second.current->id != e.orderId) return;
+        auto &sd = it->second;
+        st.totalTripTime += clock - sd.pickedAt;
+        st.busyTime += clock - sd.legStart;
+        sd.drv->setLocation(sd.current->dropoff);
+        sd.busy = false;
+        st.ordersCompleted++;
+        arrivalTime.erase(sd.current->id);
+        dispatcher.notifyOrderCompleted(sd.current->id, e.driverId, 3 + (int)(rng() % 3));
+        sd.current.reset();
+        startNext(sd);
+        break;
+    }
+    case SimEventType::DRIVER_JOIN: {
+        auto it = joining.find(e.driverId);
+        if(it == joining.end()) return;
+        addDriver(it->second);
+        joining.erase(it);
+        break;
+    }
+    case SimEventType::DRIVER_MOVE: {
+        auto it = drivers.find(e.driverId);
+        if(it != drivers.end() && !it->second.busy) it->second.drv->setLocation(e.node);
+        break;
+    }
+    case SimEventType::DRIVER_LEAVE: {
+        auto it = drivers.find(e.driverId);
+        if(it == drivers.end()) return;
+        SimDriver &sd = it->second;
+        if(sd.busy){
+            st.busyTime += clock - sd.legStart;
+            int orderId = sd.current->id;
+            dispatcher.notifyOrderCancelled(orderId, e.driverId, std::move(sd.current));
+        }
+        while(auto o = sd.drv->takeNext()){
+            int orderId = o->id;
+            dispatcher.notifyOrderCancelled(orderId, e.driverId, std::move(o));
+        }
+        dispatcher.unregisterDriver(e.driverId);
+        drivers.erase(it);
+        break;
+    }
+    }
+}
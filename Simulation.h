@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <map>
+#include <memory>
+#include <random>
+#include "models/Order.h"
+#include "models/Driver.h"
+#include "core/Graph.h"
+
+class Dispatcher;
+
+enum class SimEventType { ORDER_ARRIVAL, PASSENGER_CANCEL, DISPATCH_TICK, ARRIVE_PICKUP, ARRIVE_DROPOFF,
+                          DRIVER_JOIN, DRIVER_MOVE, DRIVER_LEAVE };
+
+struct SimEvent {
+    double time;          // virtual seconds
+    long long seq;        // tie-breaker keeps same-time events in scheduling order
+    SimEventType type;
+    int driverId;
+    int orderId;
+    int node = -1;        // DRIVER_MOVE target
+    bool operator>(const SimEvent &o) const { return time != o.time ? time > o.time : seq > o.seq; }
+};
+
+// Discrete-event driver simulation on a virtual clock. Drivers registered here
+// have no worker thread; one thread pops timestamped events, travel times come
+// from Graph distances, and the dispatcher runs on a fixed virtual tick.
+// Pooling drivers are rejected (logged and left out): only single-order trips
+// are simulated. The dispatcher can be a private instance, not just instance().
+class Simulation {
+public:
+    struct Config {
+        double speed = 10.0;             // distance units per virtual second
+        double dispatchInterval = 5.0;   // virtual seconds between dispatch rounds
+        int cancelPercent = 10;          // driver cancellation chance at pickup
+        unsigned seed = 42;
+        double pace = 0;                 // virtual seconds per wall-clock second (0: as fast as possible)
+    };
+
+    struct Stats {
+        long long ordersSubmitted = 0;
+        long long ordersCompleted = 0;
+        long long driverCancellations = 0;
+        long long passengerCancellations = 0;
+        long long dispatchRounds = 0;
+        long long eventsProcessed = 0;
+        double totalPickupTime = 0;      // order arrival -> driver at pickup, completed orders
+        double totalTripTime = 0;        // pickup -> dropoff
+        double busyTime = 0;             // summed over drivers
+        int queued = 0;                  // orders still queued after the latest round
+    };
+
+    Simulation(Dispatcher &d, const Graph &g, Config cfg);
+    Simulation(Dispatcher &d, const Graph &g): Simulation(d, g, Config{}) {}
+
+    void addDriver(std::shared_ptr<Driver> drv); // not added if drv->pooling()
+    void scheduleOrder(double at, const Order &o);
+    void scheduleCancel(double at, int orderId);
+    // drivers joining later, moved from outside (applied only while idle: trips
+    // are simulated here) and leaving; a leaving driver's orders are handed back
+    void scheduleDriver(double at, std::shared_ptr<Driver> drv);
+    void scheduleMove(double at, int driverId, int node);
+    void scheduleLeave(double at, int driverId);
+
+    // process events up to virtual time `until`
+    void run(double until);
+
+    double now() const { return clock; }
+    // nothing scheduled to arrive, nothing queued and every driver idle
+    bool settled() const;
+    const Stats& stats() const { return st; }
+
+private:
+    struct SimDriver {
+        std::shared_ptr<Driver> drv;
+        bool busy = false;
+        PooledOrder current;
+        double legStart = 0;   // when the driver set off for the pickup
+        double pickedAt = 0;
+    };
+
+    Dispatcher &dispatcher;
+    const Graph &graph;
+    Config cfg;
+    double clock{0};
+    long long nextSeq{0};
+    std::mt19937 rng;
+    std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> events;
+    std::map<int, SimDriver> drivers;
+    std::map<int, std::shared_ptr<Driver>> joining; // scheduled but not yet registered
+    std::map<int, Order> pendingOrders;   // scheduled but not yet submitted
+    std::map<int, double> arrivalTime;    // order id -> virtual submit time
+    Stats st;
+
+    void push(double at, SimEventType type, int driverId, int orderId, int node = -1);
+    double travelTime(int from, int to) const;
+    void startNext(SimDriver &sd);
+    void handle(const SimEvent &e);
+};
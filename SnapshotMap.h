@@ -0,0 +1,43 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Copy-on-write map for read-mostly tables. Readers take an immutable snapshot
+// with one std::atomic_load and never wait; writers copy the map, edit the copy
+// and publish it, serialised among themselves. Meant for small tables that
+// change rarely (registrations), since every write is O(size).
+template<typename K, typename V>
+class SnapshotMap {
+public:
+    using Map = std::unordered_map<K, V>;
+
+    SnapshotMap(): current(std::make_shared<const Map>()) {}
+    SnapshotMap(const SnapshotMap&) = delete;
+    SnapshotMap& operator=(const SnapshotMap&) = delete;
+
+    std::shared_ptr<const Map> snapshot() const { return std::atomic_load(&current); }
+
+    // edit(Map&) runs on a private copy, published when it returns
+    template<typename Edit>
+    void update(Edit edit){
+        std::lock_guard<std::mutex> lg(writeMtx);
+        auto next = std::make_shared<Map>(*std::atomic_load(&current));
+        edit(*next);
+        std::atomic_store(&current, std::shared_ptr<const Map>(std::move(next)));
+    }
+
+    // no copy when key is absent
+    void erase(const K &key){
+        std::lock_guard<std::mutex> lg(writeMtx);
+        auto cur = std::atomic_load(&current);
+        if(!cur->count(key)) return;
+        auto next = std::make_shared<Map>(*cur);
+        next->erase(key);
+        std::atomic_store(&current, std::shared_ptr<const Map>(std::move(next)));
+    }
+
+private:
+    std::shared_ptr<const Map> current;
+    std::mutex writeMtx;
+};
@@ -0,0 +1,132 @@
+#include "SurgeEngine.h"
+#include <algorithm>
+#include <cmath>
+
+SurgeEngine::SurgeEngine(SurgeConfig c): cfg(c), demand(1, 0), supply(1, 0), smoothed(1, 1.0) {
+    auto p = std::make_shared<Published>();
+    p->multiplier.assign(1, 1.0);
+    published = p;
+    ticker.start(cfg.tick, [this]{ tick(); });
+}
+
+SurgeEngine::~SurgeEngine(){
+    ticker.stop();
+}
+
+void SurgeEngine::setZones(const Graph &g, int zoneSize){
+    auto z = std::make_shared<const GraphPartition>(g, zoneSize);
+    std::lock_guard<std::mutex> lg(tickMtx);
+    zones = z;
+    rezoned = true;
+}
+
+void SurgeEngine::addObserver(std::shared_ptr<SurgeObserver> obs){
+    std::lock_guard<std::mutex> lg(obsMtx);
+    observers.push_back(std::move(obs));
+}
+
+void SurgeEngine::orderQueued(int orderId, int pickupNode){ inbox.push({Event::ORDER_QUEUED, orderId, pickupNode}); }
+void SurgeEngine::orderRemoved(int orderId){ inbox.push({Event::ORDER_REMOVED, orderId, -1}); }
+void SurgeEngine::driverAt(int driverId, int node){ inbox.push({Event::DRIVER_AT, driverId, node}); }
+void SurgeEngine::driverRemoved(int driverId){ inbox.push({Event::DRIVER_REMOVED, driverId, -1}); }
+
+double SurgeEngine::multiplierAt(int node) const {
+    auto p = std::atomic_load(&published);
+    int z = p->zoneOf(node);
+    return z >= 0 && z < (int)p->multiplier.size() ? p->multiplier[z] : 1.0;
+}
+
+double SurgeEngine::cityMultiplier() const { return std::atomic_load(&published)->city; }
+
+int SurgeEngine::zoneCount() const { return (int)std::atomic_load(&published)->multiplier.size(); }
+
+int SurgeEngine::zoneOf(int node) const {
+    if(!zones) return 0;
+    return zones->cell(node);
+}
+
+// counts from scratch after a zone change; caller holds tickMtx
+void SurgeEngine::recount(){
+    int zc = zones ? zones->cellCount() : 1;
+    demand.assign(zc, 0);
+    supply.assign(zc, 0);
+    smoothed.assign(zc, 1.0);
+    for(auto &p: orderNode){ int z = zoneOf(p.second); if(z >= 0) demand[z]++; }
+    for(auto &p: driverNode){ int z = zoneOf(p.second); if(z >= 0) supply[z]++; }
+}
+
+double SurgeEngine::raw(int d, int s) const {
+    double m = 1.0;
+    if(s > 0 && d > s) m = 1.0 + (double)(d - s) / s * cfg.sensitivity;
+    else if(s == 0 && d > 0) m = cfg.maxMultiplier; // demand with no supply at all
+    return std::min(m, cfg.maxMultiplier);
+}
+
+void SurgeEngine::tick(){
+    std::vector<ZoneSurge> changed;
+    bool cityChanged = false;
+    double city;
+    {
+        std::lock_guard<std::mutex> lg(tickMtx);
+        if(rezoned){
+            rezoned = false;
+            recount();
+        }
+        // apply the inbox as count deltas; maps remember where each order/driver was counted
+        auto move = [&](std::unordered_map<int,int> &where, std::vector<int> &count, int id, int node){
+            auto it = where.find(id);
+            if(it != where.end()){
+                int z = zoneOf(it->second);
+                if(z >= 0) count[z]--;
+                if(node < 0){ where.erase(it); return; }
+                it->second = node;
+            } else {
+                if(node < 0) return;
+                where.emplace(id, node);
+            }
+            int z = zoneOf(node);
+            if(z >= 0) count[z]++;
+        };
+        while(auto e = inbox.pop()){
+            switch(e->kind){
+            case Event::ORDER_QUEUED: move(orderNode, demand, e->id, e->node); break;
+            case Event::ORDER_REMOVED: move(orderNode, demand, e->id, -1); break;
+            case Event::DRIVER_AT: move(driverNode, supply, e->id, e->node); break;
+            case Event::DRIVER_REMOVED: move(driverNode, supply, e->id, -1); break;
+            }
+        }
+
+        auto prev = std::atomic_load(&published);
+        bool sameZones = prev->zones == zones && prev->multiplier.size() == smoothed.size();
+        auto next = std::make_shared<Published>();
+        next->zones = zones;
+        next->multiplier = sameZones ? prev->multiplier : std::vector<double>(smoothed.size(), 1.0);
+        for(size_t z=0;z<smoothed.size();z++){
+            smoothed[z] += cfg.smoothing * (raw(demand[z], supply[z]) - smoothed[z]);
+            if(std::abs(smoothed[z] - next->multiplier[z]) >= cfg.minChange){
+                next->multiplier[z] = smoothed[z];
+                changed.push_back({(int)z, smoothed[z]});
+            }
+        }
+        citySmoothed += cfg.smoothing * (raw((int)orderNode.size(), (int)driverNode.size()) - citySmoothed);
+        next->city = prev->city;
+        if(std::abs(citySmoothed - prev->city) >= cfg.minChange){
+            next->city = citySmoothed;
+            cityChanged = true;
+        }
+        city = next->city;
+        if(!changed.empty() || cityChanged || !sameZones) std::atomic_store(&published, std::shared_ptr<const Published>(std::move(next)));
+    }
+    if(changed.empty() && !cityChanged) return;
+
+    std::vector<std::shared_ptr<SurgeObserver>> obs;
+    {
+        std::lock_guard<std::mutex> lg(obsMtx);
+        obs = observers;
+    }
+    for(auto &o: obs){
+        if(!o) continue;
+        if(!changed.empty()) o->onZoneSurgeUpdate(changed);
+        if(cityChanged) o->onSurgeUpdate(city);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include "Graph.h"
+#include "GraphPartition.h"
+#include "../utils/MpscQueue.h"
+#include "../utils/PeriodicThread.h"
+
+struct ZoneSurge {
+    int zone;
+    double multiplier;
+};
+
+// Observer interface for surge/price updates. Called from the surge engine's
+// tick thread, never from the dispatcher, so a slow observer only delays
+// later surge updates.
+struct SurgeObserver {
+    virtual ~SurgeObserver() = default;
+    // city-wide multiplier, on change
+    virtual void onSurgeUpdate(double multiplier) = 0;
+    // every zone whose multiplier changed during one tick, in a single call
+    virtual void onZoneSurgeUpdate(const std::vector<ZoneSurge>& changed) { (void)changed; }
+};
+
+struct SurgeConfig {
+    std::chrono::milliseconds tick{1000}; // 0: no tick thread, call SurgeEngine::tick() yourself
+    double smoothing = 0.5;               // weight of the new raw value in the moving average
+    double sensitivity = 0.1;             // raw = 1 + max(0, (demand - supply) / supply * sensitivity)
+    // Unlike the old single city-wide formula, raw is capped here, and demand with no
+    // supply at all prices at the cap instead of 1.0: a zone with waiting orders and no
+    // drivers is the most undersupplied one
+    double maxMultiplier = 3.0;
+    double minChange = 0.01;              // smaller moves are not published
+};
+
+// Per-zone surge pricing. Producers report order and driver changes through a
+// lock-free inbox; the tick applies them to per-zone demand/supply counts,
+// recomputes smoothed multipliers and publishes the changed zones in one batch.
+// Until setZones() is called the whole city is a single zone.
+class SurgeEngine {
+public:
+    explicit SurgeEngine(SurgeConfig cfg = SurgeConfig{});
+    ~SurgeEngine();
+
+    // split the city into zones of about zoneSize nodes; counts are rebuilt on the next tick
+    void setZones(const Graph &g, int zoneSize);
+    void addObserver(std::shared_ptr<SurgeObserver> obs);
+
+    // lock-free, callable from any thread
+    void orderQueued(int orderId, int pickupNode);
+    void orderRemoved(int orderId);
+    void driverAt(int driverId, int node);
+    void driverRemoved(int driverId);
+
+    // latest published multipliers (1.0 before the first tick)
+    double multiplierAt(int node) const;
+    double cityMultiplier() const;
+    int zoneCount() const;
+
+    // drain the inbox, recompute and publish; run by the tick thread
+    void tick();
+
+private:
+    struct Event {
+        enum Kind { ORDER_QUEUED, ORDER_REMOVED, DRIVER_AT, DRIVER_REMOVED } kind;
+        int id;
+        int node;
+    };
+
+    // immutable view readers load atomically
+    struct Published {
+        std::shared_ptr<const GraphPartition> zones; // null: one zone
+        std::vector<double> multiplier;
+        double city{1.0};
+        int zoneOf(int node) const { return zones ? zones->cell(node) : 0; }
+    };
+
+    SurgeConfig cfg;
+    MpscQueue<Event> inbox;
+    std::shared_ptr<const Published> published;
+
+    // tick state, guarded by tickMtx
+    std::mutex tickMtx;
+    std::shared_ptr<const GraphPartition> zones;
+    bool rezoned{false};
+    std::unordered_map<int,int> orderNode;  // queued order -> pickup node
+    std::unordered_map<int,int> driverNode; // registered driver -> node
+    std::vector<int> demand, supply;
+    std::vector<double> smoothed;
+    double citySmoothed{1.0};
+
+    std::mutex obsMtx;
+    std::vector<std::shared_ptr<SurgeObserver>> observers;
+
+    PeriodicThread ticker;
+
+    int zoneOf(int node) const;
+    void recount();
+    double raw(int d, int s) const;
+};
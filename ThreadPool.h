@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed-size worker pool. run() executes a batch of jobs and returns when all
+// of them have finished; the workers stay alive between batches. Several
+// threads may run batches at once, and a caller works through queued jobs
+// while it waits, so run() may also be called from inside a job.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads){
+        if(threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for(int i=0;i<threads;i++) workers.emplace_back([this]{ work(); });
+    }
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for(auto &w: workers) w.join();
+    }
+
+    void run(std::vector<std::function<void()>> jobs){
+        int left = (int)jobs.size();
+        std::unique_lock<std::mutex> lk(mtx);
+        for(auto &j: jobs) queue.push({std::move(j), &left});
+        cv.notify_all();
+        while(left > 0){
+            if(queue.empty()){ done.wait(lk); continue; }
+            Task t = std::move(queue.front());
+            queue.pop();
+            lk.unlock();
+            t.job();
+            lk.lock();
+            finish(t);
+        }
+    }
+
+    int size() const { return (int)workers.size(); }
+
+    // slices forSlices cuts count items into: one per worker, one without a pool
+    static int slices(const ThreadPool *pool, size_t count){
+        return pool ? (int)std::max<size_t>(1, std::min<size_t>(pool->size(), count)) : 1;
+    }
+
+    // f(slice, begin, end) for each of slices(pool, count) ranges covering [0, count),
+    // run as one batch on pool, or inline when there is none
+    template<typename F>
+    static void forSlices(ThreadPool *pool, size_t count, F f){
+        int parts = slices(pool, count);
+        size_t chunk = (count + parts - 1) / parts;
+        auto range = [&](int s){ f(s, std::min(count, s * chunk), std::min(count, (s + 1) * chunk)); };
+        if(parts <= 1){
+            range(0);
+            return;
+        }
+        std::vector<std::function<void()>> jobs;
+        for(int s=0;s<parts;s++) jobs.push_back([&range, s]{ range(s); });
+        pool->run(std::move(jobs));
+    }
+
+private:
+    struct Task {
+        std::function<void()> job;
+        int *left; // jobs of its batch still unfinished, guarded by mtx
+    };
+    std::vector<std::thread> workers;
+    std::queue<Task> queue;
+    std::mutex mtx;
+    std::condition_variable cv, done;
+    bool stopping{false};
+
+    // caller holds mtx
+    void finish(const Task &t){
+        if(--*t.left == 0) done.notify_all();
+    }
+
+    void work(){
+        while(true){
+            Task t;
+            {
+                std::unique_lock<std::mutex> lk(mtx);
+                cv.wait(lk, [this]{ return stopping || !queue.empty(); });
+                if(stopping && queue.empty()) return;
+                t = std::move(queue.front());
+                queue.pop();
+            }
+            t.job();
+            std::lock_guard<std::mutex> lg(mtx);
+            finish(t);
+        }
+    }
+};
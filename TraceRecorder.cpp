@@ -0,0 +1,121 @@
+#include "TraceRecorder.h"
+#include "../models/Driver.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char TRACE_MAGIC[8] = {'R','H','T','R','A','C','E','2'};
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t pad;
+    int64_t startedAt; // system clock, nanoseconds since the epoch
+};
+
+}
+
+TraceRecorder::TraceRecorder(const std::string &path_, std::chrono::milliseconds flushInterval_)
+    : path(path_), started(std::chrono::steady_clock::now()), flushInterval(flushInterval_) {
+    file = std::fopen(path.c_str(), "wb");
+    if(!file){
+        LOG_ERROR("Trace {} could not be opened, nothing will be recorded", path);
+        return;
+    }
+    TraceHeader h;
+    std::memset(&h, 0, sizeof h);
+    std::memcpy(h.magic, TRACE_MAGIC, sizeof h.magic);
+    h.recordSize = sizeof(TraceRecord);
+    h.startedAt = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::fwrite(&h, sizeof h, 1, file);
+    writer = std::thread([this]{
+        std::unique_lock<std::mutex> lk(stopMtx);
+        bool stop = false;
+        while(!stop){
+            stop = stopCv.wait_for(lk, flushInterval, [this]{ return stopping; });
+            lk.unlock();
+            writeOut(); // also runs once on stop, after the last producer
+            lk.lock();
+        }
+    });
+}
+
+TraceRecorder::~TraceRecorder(){
+    {
+        std::lock_guard<std::mutex> lg(stopMtx);
+        stopping = true;
+    }
+    stopCv.notify_all();
+    if(writer.joinable()) writer.join();
+    if(file) std::fclose(file);
+}
+
+void TraceRecorder::push(TraceEvent kind, int id, int node, int dropoff, int passengerId, double fare){
+    TraceRecord r;
+    std::memset(&r, 0, sizeof r);
+    r.id = id;
+    r.node = node;
+    r.dropoff = dropoff;
+    r.passengerId = passengerId;
+    r.fare = fare;
+    r.kind = (uint8_t)kind;
+    push(r);
+}
+
+void TraceRecorder::push(const TraceRecord &rec){
+    if(!file) return;
+    TraceRecord r = rec;
+    r.t = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+    inbox.push(r);
+    count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TraceRecorder::orderSubmitted(const Order &o){ push(TraceEvent::ORDER_SUBMITTED, o.id, o.pickup, o.dropoff, o.passengerId, o.fare); }
+void TraceRecorder::orderCancelled(int orderId){ push(TraceEvent::ORDER_CANCELLED, orderId, -1); }
+void TraceRecorder::driverRegistered(const Driver &d){
+    TraceRecord r;
+    std::memset(&r, 0, sizeof r);
+    r.id = d.id;
+    r.node = d.location.load();
+    r.dropoff = -1;
+    r.ratingSum = d.ratingTotal();
+    r.ratingCount = d.ratedTrips();
+    r.seats = d.pooling() ? d.route().limits.capacity : 0;
+    r.kind = (uint8_t)TraceEvent::DRIVER_REGISTERED;
+    push(r);
+}
+void TraceRecorder::driverUnregistered(int driverId){ push(TraceEvent::DRIVER_UNREGISTERED, driverId, -1); }
+void TraceRecorder::driverMoved(int driverId, int node){ push(TraceEvent::DRIVER_MOVED, driverId, node); }
+
+void TraceRecorder::writeOut(){
+    std::vector<TraceRecord> batch;
+    while(auto r = inbox.pop()) batch.push_back(*r);
+    if(batch.empty()) return;
+    if(std::fwrite(batch.data(), sizeof(TraceRecord), batch.size(), file) != batch.size() || std::fflush(file) != 0){
+        LOG_ERROR("Trace {}: write failed, {} records lost", path, batch.size());
+    }
+}
+
+bool TraceRecorder::read(const std::string &path, std::vector<TraceRecord> &out){
+    out.clear();
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if(!f){
+        LOG_ERROR("Trace {} could not be opened", path);
+        return false;
+    }
+    TraceHeader h;
+    bool ok = std::fread(&h, sizeof h, 1, f) == 1 && std::memcmp(h.magic, TRACE_MAGIC, sizeof h.magic) == 0
+              && h.recordSize == sizeof(TraceRecord);
+    if(!ok){
+        LOG_ERROR("Trace {} is not a trace file of this version", path);
+    } else {
+        TraceRecord r;
+        while(std::fread(&r, sizeof r, 1, f) == 1) out.push_back(r);
+        // stable: records stamped at the same instant keep their file order
+        std::stable_sort(out.begin(), out.end(), [](const TraceRecord &a, const TraceRecord &b){ return a.t < b.t; });
+    }
+    std::fclose(f);
+    return ok;
+}
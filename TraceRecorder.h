@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <condition_variable>
+#include "../models/Order.h"
+#include "../utils/MpscQueue.h"
+
+enum class TraceEvent : uint8_t { ORDER_SUBMITTED, ORDER_CANCELLED, DRIVER_REGISTERED, DRIVER_UNREGISTERED, DRIVER_MOVED };
+
+class Driver;
+
+// One recorded dispatcher input, 48 bytes on disk (native-endian)
+struct TraceRecord {
+    int64_t t;            // nanoseconds since the recording started
+    int32_t id;           // order id, or driver id for driver events
+    int32_t node;         // pickup, or the driver's node
+    int32_t dropoff;
+    int32_t passengerId;
+    double fare;
+    int32_t ratingSum;    // DRIVER_REGISTERED: the driver's rating history
+    int32_t ratingCount;
+    int32_t seats;        // DRIVER_REGISTERED: pooling capacity, 0 for a single-order driver
+    uint8_t kind;         // TraceEvent
+    uint8_t pad[3];
+};
+static_assert(sizeof(TraceRecord) == 48, "trace records are fixed-size");
+
+// Records what drives the dispatcher from outside (order submissions and
+// cancellations, drivers joining, leaving and moving) to a compact binary trace
+// that TraceReplay can feed back. Recording is lock-free for the caller: records
+// are stamped and queued, and a writer thread appends them every flushInterval.
+//
+//   header (magic, record size, wall-clock start) | record | record | ...
+//
+// Records from different threads can be slightly out of order in the file;
+// read() sorts them by time. A torn tail from a crash is ignored on read.
+class TraceRecorder {
+public:
+    explicit TraceRecorder(const std::string &path, std::chrono::milliseconds flushInterval = std::chrono::milliseconds(200));
+    ~TraceRecorder(); // writes out everything queued
+
+    bool ok() const { return file != nullptr; }
+    uint64_t recorded() const { return count.load(std::memory_order_relaxed); }
+
+    void orderSubmitted(const Order &o);
+    void orderCancelled(int orderId);
+    void driverRegistered(const Driver &d);
+    void driverUnregistered(int driverId);
+    void driverMoved(int driverId, int node);
+
+    // records of a trace file ordered by time; false (with an error logged) if unreadable
+    static bool read(const std::string &path, std::vector<TraceRecord> &out);
+
+private:
+    std::string path;
+    std::FILE *file{nullptr};
+    std::chrono::steady_clock::time_point started;
+    std::chrono::milliseconds flushInterval;
+    MpscQueue<TraceRecord> inbox;
+    std::atomic<uint64_t> count{0};
+
+    std::thread writer;
+    std::mutex stopMtx;
+    std::condition_variable stopCv;
+    bool stopping{false};
+
+    void push(TraceEvent kind, int id, int node, int dropoff = -1, int passengerId = 0, double fare = 0);
+    void push(const TraceRecord &r);
+    void writeOut(); // writer thread only
+};
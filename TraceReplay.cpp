@@ -0,0 +1,79 @@
+#include "TraceReplay.h"
+#include "core/Dispatcher.h"
+#include "../utils/Logger.h"
+#include <chrono>
+
+namespace TraceReplay {
+
+// what was recorded between two snapshots (max is the later snapshot's)
+static HistogramSnapshot since(const HistogramSnapshot &after, const HistogramSnapshot &before){
+    HistogramSnapshot h = after;
+    h.count -= before.count;
+    h.sum -= before.sum;
+    for(size_t b=0;b<h.buckets.size();b++) h.buckets[b] -= before.buckets[b];
+    return h;
+}
+
+ReplayReport run(Dispatcher &d, const Graph &g, const std::vector<TraceRecord> &trace, ReplayConfig cfg){
+    ReplayReport rep;
+    rep.records = trace.size();
+    Simulation sim(d, g, cfg.sim);
+    auto inGraph = [&](int node){ return node >= 0 && node < g.n; };
+    double last = 0;
+    for(auto &r: trace){
+        double at = r.t / 1e9;
+        last = std::max(last, at);
+        switch((TraceEvent)r.kind){
+        case TraceEvent::ORDER_SUBMITTED:
+            if(!inGraph(r.node) || !inGraph(r.dropoff)){ rep.skipped++; break; }
+            sim.scheduleOrder(at, Order(r.id, r.node, r.dropoff, r.fare, r.passengerId));
+            break;
+        case TraceEvent::ORDER_CANCELLED:
+            sim.scheduleCancel(at, r.id);
+            break;
+        case TraceEvent::DRIVER_REGISTERED:
+            if(!inGraph(r.node)){ rep.skipped++; break; }
+        {
+            auto drv = std::make_shared<Driver>(r.id, r.node);
+            drv->restoreRating(r.ratingSum, r.ratingCount);
+            if(r.seats > 0){
+                PoolingLimits limits;
+                limits.capacity = r.seats;
+                drv->enablePooling(limits);
+            }
+            sim.scheduleDriver(at, drv);
+            break;
+        }
+        case TraceEvent::DRIVER_UNREGISTERED:
+            sim.scheduleLeave(at, r.id);
+            break;
+        case TraceEvent::DRIVER_MOVED:
+            if(!inGraph(r.node)){ rep.skipped++; break; }
+            sim.scheduleMove(at, r.id, r.node);
+            break;
+        default:
+            rep.skipped++;
+        }
+    }
+    if(rep.skipped) LOG_WARN("Replay: {} of {} trace records skipped", rep.skipped, rep.records);
+
+    auto before = Metrics::snapshot();
+    auto wall = std::chrono::steady_clock::now();
+    sim.run(last);
+    // let the last orders finish; two settled checks in a row span a dispatch round
+    int settled = 0;
+    while(sim.now() < last + cfg.drain && settled < 2){
+        sim.run(std::min(last + cfg.drain, sim.now() + cfg.sim.dispatchInterval));
+        settled = sim.settled() ? settled + 1 : 0;
+    }
+    rep.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall).count();
+    auto after = Metrics::snapshot();
+
+    rep.virtualSeconds = sim.now();
+    rep.sim = sim.stats();
+    rep.assignments = after.counter(Counter::ASSIGNMENTS) - before.counter(Counter::ASSIGNMENTS);
+    rep.assignNs = since(after.histogram(Histogram::ASSIGN_NS), before.histogram(Histogram::ASSIGN_NS));
+    return rep;
+}
+
+}
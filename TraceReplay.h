@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "core/Simulation.h"
+#include "core/TraceRecorder.h"
+#include "../utils/Metrics.h"
+
+struct ReplayConfig {
+    Simulation::Config sim;   // seed, dispatch interval, pace (N x real time; 0 = as fast as possible)
+    double drain = 600;       // virtual seconds to keep running after the last record while work remains
+};
+
+struct ReplayReport {
+    size_t records{0};
+    size_t skipped{0};               // records naming nodes outside the graph
+    double virtualSeconds{0};
+    double wallSeconds{0};
+    Simulation::Stats sim;
+    uint64_t assignments{0};
+    HistogramSnapshot assignNs;      // AssignmentStrategy::assign duration during the replay
+
+    double ordersPerWallSecond() const { return wallSeconds > 0 ? sim.ordersCompleted / wallSeconds : 0.0; }
+    double completionRate() const { return sim.ordersSubmitted ? (double)sim.ordersCompleted / sim.ordersSubmitted : 0.0; }
+    double meanPickupTime() const { return sim.ordersCompleted ? sim.totalPickupTime / sim.ordersCompleted : 0.0; }
+    double meanTripTime() const { return sim.ordersCompleted ? sim.totalTripTime / sim.ordersCompleted : 0.0; }
+};
+
+// Feeds a recorded trace back into a dispatcher on a Simulation: orders,
+// cancellations and driver arrivals happen at their recorded times (virtual
+// seconds from the start of the recording), trips are simulated with the
+// configured seed, so the same trace, graph, strategy and seed give the same
+// run. Recorded moves of drivers that are busy in the replay are outcomes of
+// the original run's trips and are skipped.
+//
+// The dispatcher should have no drivers of its own; drivers get ids from the trace.
+namespace TraceReplay {
+
+ReplayReport run(Dispatcher &d, const Graph &g, const std::vector<TraceRecord> &trace, ReplayConfig cfg = ReplayConfig{});
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Per-worker task deque: the owner takes from the front, thieves take from the
+// back, so a steal removes the task that would otherwise wait longest. Thieves
+// only try_lock and give up on contention; they never make the owner wait
+// behind them. size() is a lock-free hint for choosing a victim.
+template<typename T>
+class WorkDeque {
+public:
+    void push(T v){
+        std::lock_guard<std::mutex> lg(mtx);
+        items.push_back(std::move(v));
+        count.store((int)items.size(), std::memory_order_relaxed);
+    }
+
+    // owner: oldest task
+    std::optional<T> pop(){
+        std::lock_guard<std::mutex> lg(mtx);
+        if(items.empty()) return std::nullopt;
+        std::optional<T> out(std::move(items.front()));
+        items.pop_front();
+        count.store((int)items.size(), std::memory_order_relaxed);
+        return out;
+    }
+
+    // thief: look at the newest task under the lock; false when none or the deque is busy
+    template<typename F>
+    bool peekBack(F f) const {
+        std::unique_lock<std::mutex> lk(mtx, std::try_to_lock);
+        if(!lk.owns_lock() || items.empty()) return false;
+        f(items.back());
+        return true;
+    }
+
+    // thief: take the newest task if it still satisfies pred (e.g. is the one peeked)
+    template<typename Pred>
+    std::optional<T> stealIf(Pred pred){
+        std::unique_lock<std::mutex> lk(mtx, std::try_to_lock);
+        if(!lk.owns_lock() || items.empty() || !pred(items.back())) return std::nullopt;
+        std::optional<T> out(std::move(items.back()));
+        items.pop_back();
+        count.store((int)items.size(), std::memory_order_relaxed);
+        return out;
+    }
+
+    int size() const { return count.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+
+private:
+    mutable std::mutex mtx;
+    std::deque<T> items;
+    std::atomic<int> count{0};
+};
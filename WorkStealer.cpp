@@ -0,0 +1,68 @@
+#include "WorkStealer.h"
+#include <algorithm>
+#include <numeric>
+
+WorkStealer::WorkStealer(const Graph &g, StealPolicy policy): graph(&g), cfg(policy) {}
+
+WorkStealer::WorkStealer(const LiveGraph &g, StealPolicy policy): live(&g), cfg(policy) {}
+
+void WorkStealer::track(const std::shared_ptr<Driver> &drv){
+    track(std::vector<std::shared_ptr<Driver>>{drv});
+}
+
+void WorkStealer::track(const std::vector<std::shared_ptr<Driver>> &drvs){
+    fleet.update([&](Fleet::Map &f){
+        for(auto &d: drvs) if(d) f[d->id] = d;
+    });
+}
+
+void WorkStealer::untrack(int driverId){
+    fleet.erase(driverId);
+}
+
+std::optional<StolenOrder> WorkStealer::steal(Driver &thief, const DriverIndex *index){
+    auto drivers = fleet.snapshot();
+    int from = thief.location.load();
+
+    // victims: busy, FIFO (pooling routes are planned as a whole) and with a queue
+    std::vector<Driver*> victims;
+    auto consider = [&](Driver *d){
+        if(d == &thief || d->pooling() || !d->serving() || d->queued() < cfg.minQueued) return;
+        victims.push_back(d);
+    };
+    if(index){
+        for(int id: index->nearest(from, cfg.candidates)){
+            auto it = drivers->find(id);
+            if(it != drivers->end()) consider(it->second.get());
+        }
+    } else {
+        for(auto &p: *drivers) consider(p.second.get());
+    }
+    if(victims.empty()) return std::nullopt;
+
+    // one traffic version for the whole attempt
+    auto pinned = live ? live->snapshot() : nullptr;
+    const Graph &g = pinned ? *pinned : *graph;
+    std::vector<Driver*> owners;
+    std::vector<Order> offers;
+    std::vector<int> pickups;
+    for(Driver *v: victims){
+        auto o = v->newestQueued();
+        if(!o || o->pickup < 0 || o->pickup >= g.n) continue;
+        owners.push_back(v);
+        offers.push_back(*o);
+        pickups.push_back(o->pickup);
+    }
+    if(offers.empty()) return std::nullopt;
+
+    auto dist = g.distanceTable({from}, pickups);
+    std::vector<int> order(offers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b){ return dist[a] < dist[b]; });
+    for(int k: order){
+        if(dist[k] > cfg.maxDistance) break;
+        // the victim may have started or lost the order since the peek
+        if(auto o = owners[k]->stealQueued(offers[k].id)) return StolenOrder{std::move(o), owners[k]->id};
+    }
+    return std::nullopt;
+}
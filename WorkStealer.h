@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include "Graph.h"
+#include "LiveGraph.h"
+#include "DriverIndex.h"
+#include "../models/Driver.h"
+#include "../utils/SnapshotMap.h"
+
+struct StealPolicy {
+    long long maxDistance = 600; // thief -> pickup, in graph weight units
+    int minQueued = 1;           // victim must have this many orders waiting behind its current trip
+    int candidates = 8;          // nearest drivers considered per attempt (with a DriverIndex)
+};
+
+struct StolenOrder {
+    PooledOrder order; // now owned by the thief
+    int fromDriver;
+};
+
+// Moves orders that are queued behind a busy driver's current trip to an idle
+// driver nearby. Victims are the thief's nearest neighbours (all tracked
+// drivers without an index); each offers only its newest queued order, the one
+// that would wait longest, and the closest pickup within maxDistance is taken.
+// Attempts never block: a victim whose queue is in use is skipped.
+class WorkStealer {
+public:
+    WorkStealer(const Graph &g, StealPolicy policy = StealPolicy{});
+    // each steal measures pickups on the latest traffic version
+    WorkStealer(const LiveGraph &g, StealPolicy policy = StealPolicy{});
+
+    void track(const std::shared_ptr<Driver> &drv);
+    void track(const std::vector<std::shared_ptr<Driver>> &drvs);
+    void untrack(int driverId);
+
+    // called from the idle driver's thread; index may be null
+    std::optional<StolenOrder> steal(Driver &thief, const DriverIndex *index);
+
+    const StealPolicy& policy() const { return cfg; }
+
+private:
+    const Graph *graph{nullptr};
+    const LiveGraph *live{nullptr};
+    StealPolicy cfg;
+    using Fleet = SnapshotMap<int, std::shared_ptr<Driver>>;
+    Fleet fleet;
+};
@@ -0,0 +1,221 @@
+// Dispatch benchmark: synthetic or imported road networks, fleets of idle
+// drivers and Poisson order arrivals, timed through each AssignmentStrategy.
+//
+//   bench [--graph grid:300|geo:100000|dimacs:FILE|edges:FILE|bin:FILE] [--drivers 1000,10000]
+//         [--orders 200] [--rounds 20] [--index] [--no-ch] [--cache MB] [--seed 1]
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "core/Graph.h"
+#include "core/GraphIO.h"
+#include "core/GraphFile.h"
+#include "core/Scheduler.h"
+#include "core/DriverIndex.h"
+#include "core/DistanceCache.h"
+#include "models/Order.h"
+#include "models/Driver.h"
+#include "utils/Logger.h"
+
+// count every heap allocation made while a round is timed
+static std::atomic<unsigned long long> allocCount{0};
+void* operator new(size_t sz){
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    if(void *p = std::malloc(sz ? sz : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+static Graph gridGraph(int side, std::mt19937 &rng){
+    Graph g(side * side);
+    std::uniform_int_distribution<int> w(5, 20);
+    for(int r=0;r<side;r++) for(int c=0;c<side;c++){
+        int v = r*side + c;
+        if(c+1<side) g.addEdge(v, v+1, w(rng));
+        if(r+1<side) g.addEdge(v, v+side, w(rng));
+    }
+    return g;
+}
+
+// random geometric graph: points in the unit square, each linked to its
+// nearest neighbours found through a bucket grid, weight = distance
+static Graph geometricGraph(int n, std::mt19937 &rng){
+    std::uniform_real_distribution<double> U(0, 1);
+    std::vector<double> x(n), y(n);
+    for(int i=0;i<n;i++){ x[i] = U(rng); y[i] = U(rng); }
+    int cells = std::max(1, (int)std::sqrt(n / 2.0));
+    std::vector<std::vector<int>> bucket(cells * cells);
+    auto cellOf = [&](double v){ return std::min(cells - 1, (int)(v * cells)); };
+    for(int i=0;i<n;i++) bucket[cellOf(y[i]) * cells + cellOf(x[i])].push_back(i);
+    Graph g(n);
+    const int K = 3;
+    for(int i=0;i<n;i++){
+        std::vector<std::pair<double,int>> near;
+        int cx = cellOf(x[i]), cy = cellOf(y[i]);
+        for(int dy=-1;dy<=1;dy++) for(int dx=-1;dx<=1;dx++){
+            int bx = cx+dx, by = cy+dy;
+            if(bx<0 || by<0 || bx>=cells || by>=cells) continue;
+            for(int j: bucket[by*cells + bx]) if(j != i) near.push_back({std::hypot(x[i]-x[j], y[i]-y[j]), j});
+        }
+        int k = std::min<int>(K, (int)near.size());
+        std::partial_sort(near.begin(), near.begin() + k, near.end());
+        for(int t=0;t<k;t++) g.addEdge(i, near[t].second, 1 + (int)(near[t].first * 100000)); // mutual pairs end up doubled, harmless
+    }
+    return g;
+}
+
+static double percentile(std::vector<double> v, double p){
+    if(v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t k = std::min(v.size() - 1, (size_t)std::ceil(p / 100.0 * v.size()) - (p > 0 ? 1 : 0));
+    return v[k];
+}
+
+struct Options {
+    std::string graph = "grid:200";
+    std::vector<int> fleets{1000, 10000};
+    double ordersPerRound = 200;
+    int rounds = 20;
+    bool useIndex = false;
+    bool useCh = true;
+    int cacheMb = 0;            // hierarchy search cache shared by all rounds (0: off)
+    unsigned seed = 1;
+};
+
+static Options parse(int argc, char **argv){
+    Options o;
+    for(int i=1;i<argc;i++){
+        std::string a = argv[i];
+        auto next = [&]{ return i+1 < argc ? std::string(argv[++i]) : std::string(); };
+        if(a == "--graph") o.graph = next();
+        else if(a == "--drivers"){
+            o.fleets.clear();
+            std::string list = next();
+            for(size_t p=0;p<list.size();){
+                size_t q = list.find(',', p);
+                o.fleets.push_back(std::atoi(list.substr(p, q - p).c_str()));
+                p = q == std::string::npos ? list.size() : q + 1;
+            }
+        }
+        else if(a == "--orders") o.ordersPerRound = std::atof(next().c_str());
+        else if(a == "--rounds") o.rounds = std::atoi(next().c_str());
+        else if(a == "--index") o.useIndex = true;
+        else if(a == "--no-ch") o.useCh = false;
+        else if(a == "--cache") o.cacheMb = std::atoi(next().c_str());
+        else if(a == "--seed") o.seed = (unsigned)std::atoi(next().c_str());
+        else { std::cerr << "unknown option " << a << "\n"; std::exit(2); }
+    }
+    return o;
+}
+
+static Graph buildGraph(const std::string &spec, std::mt19937 &rng){
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon), arg = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    if(kind == "grid") return gridGraph(std::atoi(arg.c_str()), rng);
+    if(kind == "geo") return geometricGraph(std::atoi(arg.c_str()), rng);
+    if(kind == "dimacs") return GraphIO::loadDimacs(arg);
+    if(kind == "edges") return GraphIO::loadEdgeList(arg);
+    if(kind == "bin") return GraphFile::map(arg); // already frozen, usually with a hierarchy
+    return Graph();
+}
+
+int main(int argc, char **argv){
+    Options opt = parse(argc, argv);
+    Logger::setLevel(LogLevel::WARN);
+    std::mt19937 rng(opt.seed);
+
+    auto t0 = std::chrono::steady_clock::now();
+    Graph g = buildGraph(opt.graph, rng);
+    if(g.n == 0){ std::cerr << "could not build graph " << opt.graph << "\n"; return 1; }
+    auto t1 = std::chrono::steady_clock::now();
+    if(opt.useCh) g.preprocess(); else { g.ch.reset(); g.freeze(); }
+    auto t2 = std::chrono::steady_clock::now();
+    printf("graph %s: %d nodes, load %.0f ms, preprocessing %.0f ms (%s)\n", opt.graph.c_str(), g.n,
+           std::chrono::duration<double, std::milli>(t1 - t0).count(), std::chrono::duration<double, std::milli>(t2 - t1).count(),
+           opt.useCh ? "CH" : "CSR only");
+    if(opt.cacheMb > 0) g.enableDistanceCache((size_t)opt.cacheMb << 20);
+
+    std::vector<std::pair<std::string, std::shared_ptr<AssignmentStrategy>>> strategies{
+        {"Nearest", std::make_shared<NearestStrategy>()},
+        {"LoadBalanced", std::make_shared<LoadBalancedStrategy>()},
+        {"RatingPriority", std::make_shared<RatingPriorityStrategy>()},
+        {"BatchOptimal", std::make_shared<BatchOptimalStrategy>()},
+    };
+
+    printf("%-15s %8s %9s %9s %9s %11s %11s %13s %9s %11s\n", "strategy", "drivers", "p50 ms", "p95 ms", "p99 ms", "orders/s", "allocs/rnd", "mean pickup", "assigned", "unreachable");
+    for(int fleet: opt.fleets){
+        for(auto &[name, strat]: strategies){
+            std::mt19937 r(opt.seed * 7919 + fleet); // same fleet and demand for every strategy
+            std::uniform_int_distribution<int> node(0, g.n - 1);
+            std::poisson_distribution<int> arrivals(opt.ordersPerRound);
+            std::vector<std::shared_ptr<Driver>> drivers;
+            for(int i=0;i<fleet;i++) drivers.push_back(std::make_shared<Driver>(i, node(r)));
+            std::unique_ptr<DriverIndex> index;
+            DispatchContext ctx;
+            if(opt.useIndex){
+                index = std::make_unique<DriverIndex>(g);
+                for(int i=0;i<fleet;i++){ index->update(i, drivers[i]->location.load()); ctx.driverSlot[i] = i; }
+                ctx.index = index.get();
+            }
+
+            std::vector<Order> queue;
+            std::vector<double> latency;
+            unsigned long long allocs = 0, assignedTotal = 0, reachable = 0;
+            double totalMs = 0, pickupSum = 0;
+            int nextId = 0;
+            for(int round=0;round<opt.rounds;round++){
+                int k = arrivals(r);
+                for(int i=0;i<k;i++) queue.emplace_back(nextId++, node(r), node(r), 10.0);
+                if(queue.empty()) continue;
+
+                OrderSpan batch(queue);
+                unsigned long long a0 = allocCount.load();
+                auto s = std::chrono::steady_clock::now();
+                auto assigns = strat->assign(batch, drivers, g, ctx);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s).count();
+                allocs += allocCount.load() - a0;
+                latency.push_back(ms);
+                totalMs += ms;
+
+                // quality, then complete the trips instantly: drivers move to the dropoffs
+                std::vector<char> taken(queue.size(), 0);
+                std::vector<int> pos(nextId, -1);
+                for(size_t j=0;j<queue.size();j++) pos[queue[j].id] = (int)j;
+                for(auto &pr: assigns){
+                    const Order &o = queue[pos[pr.first]];
+                    auto &d = drivers[pr.second];
+                    long long pd = g.distanceTable({d->location.load()}, {o.pickup})[0];
+                    if(pd < Graph::INF){ pickupSum += (double)pd; reachable++; }
+                    d->location.store(o.dropoff);
+                    if(index) index->update(d->id, o.dropoff);
+                    taken[pos[pr.first]] = 1;
+                    assignedTotal++;
+                }
+                std::vector<Order> rest;
+                for(size_t j=0;j<queue.size();j++) if(!taken[j]) rest.push_back(queue[j]);
+                queue.swap(rest);
+            }
+            printf("%-15s %8d %9.2f %9.2f %9.2f %11.0f %11.0f %13.1f %9llu %11llu\n", name.c_str(), fleet,
+                   percentile(latency, 50), percentile(latency, 95), percentile(latency, 99),
+                   totalMs > 0 ? assignedTotal / (totalMs / 1000.0) : 0.0,
+                   latency.empty() ? 0.0 : (double)allocs / latency.size(),
+                   reachable ? pickupSum / reachable : 0.0, assignedTotal, assignedTotal - reachable);
+        }
+    }
+    if(g.cache){
+        auto cs = g.cache->stats();
+        printf("distance cache: %.1f%% hits (%llu / %llu), %zu entries, %.1f MB, %llu evictions\n", 100.0 * cs.hitRate(),
+               (unsigned long long)cs.hits, (unsigned long long)(cs.hits + cs.misses), cs.entries, cs.bytes / 1048576.0,
+               (unsigned long long)cs.evictions);
+    }
+    return 0;
+}
@@ -4,17 +4,23 @@
 #include <chrono>
 #include <vector>
 #include "core/Graph.h"
+#include "core/LiveGraph.h"
 #include "models/Order.h"
 #include "models/Driver.h"
 #include "core/Dispatcher.h"
 #include "core/Scheduler.h"
+#include "core/DispatchService.h"
 #include "patterns/Factory.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 
 // Simple observer to print surge updates
 struct ConsoleSurgeObserver : public SurgeObserver {
     void onSurgeUpdate(double multiplier) override {
-        Logger::info(std::string("Surge multiplier now: x") + std::to_string(multiplier));
+        LOG_INFO("Surge multiplier now: x{}", multiplier);
+    }
+    void onZoneSurgeUpdate(const std::vector<ZoneSurge>& changed) override {
+        for(auto &z: changed) LOG_INFO("Zone {} surge now: x{}", z.zone, z.multiplier);
     }
 };
 
@@ -25,6 +31,11 @@ int main(){
     g.addEdge(2,3,4);
     g.addEdge(1,4,2);
     g.addEdge(4,5,6);
+    g.coords = std::vector<NodeCoord>{{52.500f,13.400f},{52.500f,13.410f},{52.500f,13.420f},{52.500f,13.430f},{52.510f,13.410f},{52.520f,13.410f}};
+    g.preprocess(); // build routing index once the road network is loaded
+    g.enableDistanceCache(); // parked drivers are searched once per graph version, not every round
+
+    Metrics::startDump("metrics.prom", std::chrono::seconds(1));
 
     // create drivers
     auto d1 = DriverFactory::create(401, 0);
@@ -35,6 +46,21 @@ int main(){
     Dispatcher::instance().registerDriver(d2);
     Dispatcher::instance().registerDriver(d3);
 
+    Dispatcher::instance().enableSpatialIndex(g);
+    Dispatcher::instance().enableZonalSurge(g, 3);
+    Dispatcher::instance().enableLocationFeed(g); // phones report positions between pickups and dropoffs
+
+    // traffic feeds update a live copy of the road network; rounds always see the latest weights
+    LiveGraph roads(g);
+
+    Dispatcher::instance().enableWorkStealing(roads); // idle drivers take over orders queued behind a busy neighbour
+    RepositionConfig reposition;
+    reposition.zoneSize = 3;
+    reposition.tick = std::chrono::milliseconds(2000);
+    Dispatcher::instance().enableRepositioning(roads, reposition); // idle drivers head to where orders are expected
+    // everything from here on can be rerun with: replay --trace dispatch.trace --graph ...
+    Dispatcher::instance().recordTrace(std::make_shared<TraceRecorder>("dispatch.trace"));
+
     // add observer for surge updates
     auto obs = std::make_shared<ConsoleSurgeObserver>();
     Dispatcher::instance().addObserver(obs);
@@ -43,26 +69,29 @@ int main(){
     auto strat = std::make_shared<NearestStrategy>();
     Dispatcher::instance().setStrategy(strat);
 
+    // rounds run continuously from here on, batching arrivals per adaptive window
+    DispatchService service(Dispatcher::instance(), roads);
+    service.start();
+
     // submit orders
     Dispatcher::instance().submitOrder(Order(5001, 4, 5, 12.0));
     Dispatcher::instance().submitOrder(Order(5002, 2, 3, 8.0));
     Dispatcher::instance().submitOrder(Order(5003, 1, 5, 10.0));
 
-    // dispatch
-    Dispatcher::instance().runDispatch(g);
-
     std::this_thread::sleep_for(std::chrono::seconds(4));
 
+    // congestion report: road 1-2 slows down
+    roads.updateWeight(1, 2, 15);
+
+    // switch to LoadBalanced strategy
+    Dispatcher::instance().setStrategy(std::make_shared<LoadBalancedStrategy>());
+
     // simulate more demand
     Dispatcher::instance().submitOrder(Order(6001, 0, 2, 9.0));
     Dispatcher::instance().submitOrder(Order(6002, 2, 5, 11.0));
     Dispatcher::instance().submitOrder(Order(6003, 3, 0, 7.0));
     Dispatcher::instance().submitOrder(Order(6004, 1, 4, 6.0));
 
-    // switch to LoadBalanced strategy
-    Dispatcher::instance().setStrategy(std::make_shared<LoadBalancedStrategy>());
-    Dispatcher::instance().runDispatch(g);
-
     std::this_thread::sleep_for(std::chrono::seconds(2));
 
     // simulate passenger cancellation
@@ -78,18 +107,43 @@ int main(){
     // switch to RatingPriority strategy
     Dispatcher::instance().setStrategy(std::make_shared<RatingPriorityStrategy>());
 
-    // submit final batch and dispatch
+    // submit final batch
     Dispatcher::instance().submitOrder(Order(7001, 2, 0, 10.0));
     Dispatcher::instance().submitOrder(Order(7002, 5, 1, 9.0));
-    Dispatcher::instance().runDispatch(g);
 
     std::this_thread::sleep_for(std::chrono::seconds(6));
 
+    // peak hours: shared rides, two riders heading the same way can share a car
+    d1->enablePooling(PoolingLimits{});
+    d3->enablePooling(PoolingLimits{});
+    Dispatcher::instance().setStrategy(std::make_shared<PoolingStrategy>());
+    Dispatcher::instance().submitOrder(Order(8001, 0, 5, 14.0));
+    Dispatcher::instance().submitOrder(Order(8002, 1, 5, 12.0));
+
+    std::this_thread::sleep_for(std::chrono::seconds(6));
+
+    // GPS pings arrive in batches; only the newest per driver is applied, at the start of the
+    // next round, so the order below is matched against where 402 actually is (near node 4)
+    std::vector<GpsPing> pings{{402, 52.5091f, 13.4102f, 1000}, {402, 52.5003f, 13.4298f, 900}, {403, 52.5187f, 13.4099f, 1000}};
+    Dispatcher::instance().ingestPings(pings);
+    Dispatcher::instance().setStrategy(std::make_shared<NearestStrategy>());
+    Dispatcher::instance().submitOrder(Order(9001, 4, 0, 8.0));
+
+    std::this_thread::sleep_for(std::chrono::seconds(4));
+
     // cleanup
+    service.stop();
     Dispatcher::instance().unregisterDriver(401);
     Dispatcher::instance().unregisterDriver(402);
     Dispatcher::instance().unregisterDriver(403);
+    Dispatcher::instance().recordTrace(nullptr); // last reference: flushes and closes the trace
+
+    Metrics::stopDump(); // writes the final metrics.prom
+    auto m = Metrics::snapshot();
+    LOG_INFO("Dispatch rounds: {}, assignments: {}, assign p99: {} us", m.counter(Counter::DISPATCH_ROUNDS),
+             m.counter(Counter::ASSIGNMENTS), m.histogram(Histogram::ASSIGN_NS).quantile(0.99) / 1000);
 
+    Logger::flush(); // drain async log records before writing to stdout directly
     std::cout<<"Simulation end."<<std::endl;
     return 0;
 }
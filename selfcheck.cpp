@@ -0,0 +1,488 @@
+// Correctness checks: each building block against a slow reference on small
+// random inputs.
+//
+//   selfcheck [--only ch|live|batch|store|insertion|pool] [--seed 1] [--dir DIR]
+//
+//   ch         contraction hierarchy distance tables and pair distances vs plain Dijkstra
+//   live       exact LiveGraph versions after random weight updates vs Dijkstra
+//   batch      BatchOptimalStrategy vs brute-force maximum matching, then minimum cost,
+//              over the same k nearest candidates
+//   store      OrderStore journal: crash (process exit without shutdown), torn tail, replay,
+//              failed writes
+//   insertion  routing::bestInsertion vs enumerating every pickup/dropoff position
+//   pool       OrderPool acquire, release, slot reuse and stale refs, single and multi-threaded
+//
+// Prints one line per check and exits 1 if any fails. --dir is where the store
+// check keeps its journal (default: a fresh directory under /tmp). The store
+// check forks its crashing writer; under ThreadSanitizer run it with
+// TSAN_OPTIONS=die_after_fork=0.
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <string>
+#include <random>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "core/Graph.h"
+#include "core/LiveGraph.h"
+#include "core/Scheduler.h"
+#include "core/OrderStore.h"
+#include "core/RouteInsertion.h"
+#include "models/Order.h"
+#include "models/Driver.h"
+#include "models/OrderPool.h"
+#include "utils/Logger.h"
+#include "utils/ThreadPool.h"
+
+// first few failures are printed, the rest only counted
+static int report(int bad, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static int report(int bad, const char *fmt, ...){
+    if(bad < 5){
+        va_list ap;
+        va_start(ap, fmt);
+        std::printf("    ");
+        std::vprintf(fmt, ap);
+        std::printf("\n");
+        va_end(ap);
+    }
+    return bad + 1;
+}
+
+static Graph gridGraph(int side, std::mt19937 &rng){
+    Graph g(side * side);
+    std::uniform_int_distribution<int> w(5, 20);
+    for(int r=0;r<side;r++) for(int c=0;c<side;c++){
+        int v = r*side + c;
+        if(c+1<side) g.addEdge(v, v+1, w(rng));
+        if(r+1<side) g.addEdge(v, v+side, w(rng));
+    }
+    return g;
+}
+
+// random spanning tree plus extra edges: uneven degrees, parallel edges and loops included
+static Graph randomGraph(int n, int extra, std::mt19937 &rng){
+    Graph g(n);
+    for(int i=1;i<n;i++) g.addEdge(i, (int)(rng() % i), 1 + (int)(rng() % 30));
+    for(int e=0;e<extra;e++) g.addEdge((int)(rng() % n), (int)(rng() % n), 1 + (int)(rng() % 30));
+    return g;
+}
+
+// distanceTable(sources, targets) must equal a Dijkstra per source
+static int compareTable(const Graph &g, const std::vector<int> &src, const std::vector<int> &dst, int bad, const char *what,
+                        ThreadPool *pool = nullptr){
+    auto table = g.distanceTable(src, dst, pool);
+    for(size_t i=0;i<src.size();i++){
+        auto d = g.dijkstra(src[i]);
+        for(size_t j=0;j<dst.size();j++){
+            if(table[i * dst.size() + j] != d[dst[j]])
+                bad = report(bad, "%s: %d -> %d is %lld, Dijkstra %lld", what, src[i], dst[j], table[i * dst.size() + j], d[dst[j]]);
+        }
+    }
+    return bad;
+}
+
+static std::vector<int> randomNodes(int n, int count, std::mt19937 &rng){
+    std::vector<int> v;
+    for(int i=0;i<count;i++) v.push_back((int)(rng() % n));
+    return v;
+}
+
+static int checkCh(std::mt19937 &rng){
+    int bad = 0;
+    ThreadPool pool(3);
+    for(int it=0;it<20;it++){
+        Graph g = it % 2 ? gridGraph(12 + it, rng) : randomGraph(200 + 40 * it, 100 + 20 * it, rng);
+        g.preprocess();
+        bad = compareTable(g, randomNodes(g.n, 20, rng), randomNodes(g.n, 30, rng), bad, "hierarchy");
+        bad = compareTable(g, randomNodes(g.n, 20, rng), randomNodes(g.n, 30, rng), bad, "hierarchy, pooled", &pool);
+        // sparse pairs, repeated nodes on both sides
+        std::vector<std::pair<int,int>> pairs;
+        auto from = randomNodes(g.n, 8, rng), to = randomNodes(g.n, 8, rng);
+        for(int k=0;k<40;k++) pairs.push_back({from[rng() % from.size()], to[rng() % to.size()]});
+        Graph plain = g; // same pairs through per-source searches
+        plain.ch.reset();
+        auto got = g.pairDistances(pairs, it % 2 ? &pool : nullptr), gotPlain = plain.pairDistances(pairs, &pool);
+        for(size_t k=0;k<pairs.size();k++){
+            long long want = g.dijkstra(pairs[k].first)[pairs[k].second];
+            if(got[k] != want || gotPlain[k] != want)
+                bad = report(bad, "pairs: %d -> %d is %lld (%lld without hierarchy), Dijkstra %lld", pairs[k].first, pairs[k].second, got[k], gotPlain[k], want);
+        }
+    }
+    return bad;
+}
+
+static int checkLive(std::mt19937 &rng){
+    int bad = 0;
+    const int side = 20;
+    LiveGraphConfig cfg;
+    cfg.publishInterval = std::chrono::milliseconds(0);
+    cfg.exact = true;
+    LiveGraph live(gridGraph(side, rng), cfg);
+    for(int batch=0;batch<30;batch++){
+        // slow-downs, speed-ups and closures, several per version
+        for(int k=0;k<10;k++){
+            int u = (int)(rng() % (side * side)), v = u % side + 1 < side ? u + 1 : u - 1;
+            int w = rng() % 10 == 0 ? 1000000 : 1 + (int)(rng() % 60);
+            live.updateWeight(u, v, w);
+        }
+        live.publish();
+        auto g = live.snapshot();
+        bad = compareTable(*g, randomNodes(g->n, 5, rng), randomNodes(g->n, 40, rng), bad, "live");
+    }
+    return bad;
+}
+
+// BatchOptimalStrategy(k) against every subset of orders matched to distinct
+// drivers among each order's k nearest; false when a tie at the cut makes the
+// candidate sets ambiguous
+static bool compareBatch(const Graph &g, const std::vector<Order> &orders, const int *driversAt, int D, int k, int threads,
+                         int &bad, const char *what){
+    const int M = (int)orders.size();
+    std::vector<std::shared_ptr<Driver>> drivers;
+    std::vector<std::vector<long long>> cost(D);
+    for(int i=0;i<D;i++){
+        drivers.push_back(std::make_shared<Driver>(i, driversAt[i]));
+        cost[i] = g.dijkstra(driversAt[i]);
+    }
+    std::vector<std::vector<char>> allowed(M, std::vector<char>(D, 0));
+    for(int j=0;j<M;j++){
+        std::vector<std::pair<long long,int>> near;
+        for(int i=0;i<D;i++) near.push_back({cost[i][orders[j].pickup], i});
+        std::sort(near.begin(), near.end());
+        for(int t=0;t<std::min(k, D);t++) allowed[j][near[t].second] = 1;
+        if(k < D && near[k-1].first == near[k].first) return false;
+    }
+
+    BatchOptimalStrategy strategy(k, threads, std::chrono::milliseconds(1000));
+    auto got = strategy.assign(orders, drivers, g);
+    long long gotCost = 0;
+    for(auto &p: got) gotCost += cost[p.second][orders[p.first].pickup];
+
+    int bestCount = -1;
+    long long bestCost = 0;
+    std::function<void(int,int,long long,int)> rec = [&](int j, int used, long long c, int count){
+        if(j == M){
+            if(count > bestCount || (count == bestCount && c < bestCost)){ bestCount = count; bestCost = c; }
+            return;
+        }
+        rec(j+1, used, c, count);
+        for(int i=0;i<D;i++) if(allowed[j][i] && !(used >> i & 1)) rec(j+1, used | 1 << i, c + cost[i][orders[j].pickup], count + 1);
+    };
+    rec(0, 0, 0, 0);
+    if((int)got.size() != bestCount || gotCost != bestCost)
+        bad = report(bad, "%s (k=%d): %zu orders matched at cost %lld, best is %d at %lld", what, k, got.size(), gotCost, bestCount, bestCost);
+    return true;
+}
+
+static int checkBatch(std::mt19937 &rng){
+    int bad = 0, compared = 0;
+
+    // serving the last order moves every driver one stop down the chain, which costs
+    // more than twice the dearest single pickup: size must still win over cost
+    Graph chain(6);
+    int legs[] = {30, 24, 23, 22, 21};
+    for(int u=0;u<5;u++) chain.addEdge(u, u+1, legs[u]);
+    chain.preprocess();
+    std::vector<Order> chainOrders;
+    for(int j=0;j<5;j++) chainOrders.push_back(Order(j, (j + 1) % 5, 0, 5));
+    int chainDrivers[] = {1, 2, 3, 4, 5};
+    compareBatch(chain, chainOrders, chainDrivers, 5, 2, 1, bad, "chain");
+
+    for(int it=0;it<400;it++){
+        const int n = 12;
+        Graph g = randomGraph(n, 6, rng);
+        g.preprocess();
+        int M = 1 + (int)(rng() % 6), D = 1 + (int)(rng() % 6);
+        const int ks[] = {1, 2, 3, 8};
+        std::vector<Order> orders;
+        for(int j=0;j<M;j++) orders.push_back(Order(j, (int)(rng() % n), (int)(rng() % n), 5));
+        int at[6];
+        for(int i=0;i<D;i++) at[i] = (int)(rng() % n);
+        std::string what = "instance " + std::to_string(it);
+        compared += compareBatch(g, orders, at, D, ks[it % 4], it % 2 ? 1 : 3, bad, what.c_str());
+    }
+    if(compared < 100) bad = report(bad, "only %d instances without ties", compared);
+    return bad;
+}
+
+// expected store contents: id -> (status, driver)
+using StoreModel = std::map<int, std::pair<OrderStatus,int>>;
+
+static void storeOps(OrderStore &s, StoreModel &m, unsigned seed, int ops){
+    std::mt19937 rng(seed);
+    for(int k=0;k<ops;k++){
+        int id = (int)(rng() % 60);
+        if(rng() % 3 == 0){
+            s.put(Order(id, id % 7, id % 5, 1.0));
+            m[id] = {OrderStatus::QUEUED, -1};
+            continue;
+        }
+        OrderStatus st = (OrderStatus)(rng() % 5);
+        int drv = (int)(rng() % 9);
+        s.transition(id, st, drv);
+        auto it = m.find(id);
+        if(it == m.end()) continue;
+        if(st == OrderStatus::COMPLETED || st == OrderStatus::CANCELLED) m.erase(it);
+        else it->second = {st, drv};
+    }
+}
+
+static int compareStore(const OrderStore &s, const StoreModel &m, int bad, const char *when){
+    if(s.size() != m.size()) bad = report(bad, "%s: %zu orders, expected %zu", when, s.size(), m.size());
+    for(auto &p: m){
+        auto o = s.get(p.first);
+        if(!o){ bad = report(bad, "%s: order %d lost", when, p.first); continue; }
+        bool assigned = p.second.first == OrderStatus::ASSIGNED || p.second.first == OrderStatus::IN_PROGRESS;
+        if(o->status != p.second.first || o->pickup != p.first % 7 || o->dropoff != p.first % 5
+           || (assigned && s.driverOf(p.first) != p.second.second))
+            bad = report(bad, "%s: order %d has status %d driver %d, expected %d driver %d", when, p.first,
+                         (int)o->status, s.driverOf(p.first), (int)p.second.first, p.second.second);
+    }
+    return bad;
+}
+
+static int checkStore(std::mt19937 &rng, std::string dir){
+    int bad = 0;
+    bool ownDir = dir.empty();
+    if(ownDir){
+        char tmpl[] = "/tmp/selfcheck.XXXXXX";
+        if(!mkdtemp(tmpl)) return report(bad, "cannot create a journal directory");
+        dir = tmpl;
+    }
+    OrderStore::Options opts;
+    opts.dir = dir;
+    opts.snapshotEvery = 150; // several snapshots per run, journal records on top of the last
+    unsigned seed = (unsigned)rng();
+    const int ops = 1000;
+
+    // crash: the child leaves without closing the store, right after its last commit
+    Logger::flush();
+    pid_t child = fork();
+    if(child == 0){
+        StoreModel scratch;
+        OrderStore s(opts);
+        storeOps(s, scratch, seed, ops);
+        s.waitDurable(s.lastSequence());
+        _exit(0);
+    }
+    int status = 0;
+    if(child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return report(bad, "crashing writer did not run to its last commit");
+    StoreModel model;
+    {
+        OrderStore scratch; // in memory: the same operations give the expected state
+        storeOps(scratch, model, seed, ops);
+    }
+
+    // torn write: half a frame after the last committed record
+    int fd = ::open((dir + "/orders.journal").c_str(), O_WRONLY | O_APPEND);
+    char junk[20] = {1, 2, 3};
+    if(fd < 0 || ::write(fd, junk, sizeof junk) != (ssize_t)sizeof junk) bad = report(bad, "cannot tear the journal");
+    if(fd >= 0) ::close(fd);
+
+    {
+        OrderStore s(opts);
+        bad = compareStore(s, model, bad, "after crash");
+        // appends must land after the cut tail, not behind the junk
+        storeOps(s, model, seed + 1, ops);
+    }
+    {
+        OrderStore s(opts);
+        bad = compareStore(s, model, bad, "after restart");
+    }
+
+    for(const char *f: {"/orders.journal", "/orders.snapshot", "/orders.snapshot.tmp"}) ::unlink((dir + f).c_str());
+
+    // a journal whose writes fail must never report records as durable
+    if(::symlink("/dev/full", (dir + "/orders.journal").c_str()) == 0){
+        OrderStore s(opts);
+        s.put(Order(1, 2, 3, 4.0));
+        if(s.waitDurable(s.lastSequence())) bad = report(bad, "record reported durable on a full device");
+    }
+
+    for(const char *f: {"/orders.journal", "/orders.snapshot", "/orders.snapshot.tmp"}) ::unlink((dir + f).c_str());
+    if(ownDir) ::rmdir(dir.c_str());
+    return bad;
+}
+
+static int checkInsertion(std::mt19937 &rng){
+    int bad = 0;
+    std::vector<std::pair<int,int>> pts;
+    auto dist = [&](int a, int b){ return (long long)std::llround(10 * std::hypot(pts[a].first - pts[b].first, pts[a].second - pts[b].second)); };
+
+    // length of a stop sequence from r.origin, or -1 when it breaks capacity, detour or pickup limits
+    auto routeLength = [&](const RoutePlan &r, const std::vector<RouteStop> &stops, int newPickup){
+        long long t = 0;
+        int load = r.onboard, prev = r.origin;
+        std::vector<long long> at(stops.size());
+        for(size_t k=0;k<stops.size();k++){
+            t += dist(prev, stops[k].node);
+            at[k] = t;
+            prev = stops[k].node;
+            load += stops[k].pickup ? 1 : -1;
+            if(load > r.limits.capacity) return -1LL;
+            if((int)k == newPickup && r.limits.maxPickup > 0 && t > r.limits.maxPickup) return -1LL;
+        }
+        for(size_t k=0;k<stops.size();k++){
+            if(stops[k].pickup) continue;
+            long long from = 0;
+            for(size_t q=0;q<k;q++) if(stops[q].pickup && stops[q].orderId == stops[k].orderId) from = at[q];
+            if(at[k] - from > stops[k].budget) return -1LL;
+        }
+        return t;
+    };
+
+    int compared = 0;
+    for(int it=0;it<5000;it++){
+        pts.clear();
+        for(int i=0;i<12;i++) pts.push_back({(int)(rng() % 100), (int)(rng() % 100)});
+        RoutePlan r;
+        r.origin = 0;
+        r.limits.capacity = 1 + (int)(rng() % 3);
+        r.limits.maxDetour = 1.2 + (rng() % 10) / 10.0;
+        if(rng() % 3 == 0) r.limits.maxPickup = 50 + (long long)(rng() % 200);
+
+        // route built by the library itself, then one more order to place
+        int next = 1;
+        for(int k=0;k<4;k++){
+            int p = next++, d = next++;
+            std::vector<long long> toP{dist(p, r.origin)}, toD{dist(d, r.origin)};
+            for(auto &s: r.stops){ toP.push_back(dist(p, s.node)); toD.push_back(dist(d, s.node)); }
+            auto ins = routing::bestInsertion(r, toP.data(), toD.data(), dist(p, d));
+            if(k < 3){
+                if(ins.valid()) routing::insert(r, ins, 100 + k, p, d, toP.data(), toD.data(), dist(p, d));
+                continue;
+            }
+            long long base = routeLength(r, r.stops, -1);
+            if(base < 0) break;
+            long long best = Graph::INF;
+            int m = (int)r.stops.size();
+            for(int i=0;i<=m;i++) for(int j=i;j<=m;j++){
+                std::vector<RouteStop> stops = r.stops;
+                stops.insert(stops.begin() + j, RouteStop{999, d, false, 0, (long long)(r.limits.maxDetour * (double)dist(p, d))});
+                stops.insert(stops.begin() + i, RouteStop{999, p, true, 0, 0});
+                long long len = routeLength(r, stops, i);
+                if(len >= 0) best = std::min(best, len - base);
+            }
+            long long got = ins.valid() ? ins.cost : Graph::INF;
+            if(got != best) bad = report(bad, "route of %d stops: insertion costs %lld, enumeration %lld", m, got, best);
+            compared++;
+        }
+    }
+    if(compared == 0) bad = report(bad, "no route was feasible to compare");
+    return bad;
+}
+
+static int checkPool(std::mt19937 &rng){
+    int bad = 0;
+    auto &pool = OrderPool::instance();
+    const size_t base = pool.live();
+
+    std::vector<PooledOrder> held;
+    for(int i=0;i<1000;i++) held.push_back(pool.acquire(Order(i, i, i + 1, 1.0)));
+    if(pool.live() != base + 1000) bad = report(bad, "%zu live after 1000 acquires, expected %zu", pool.live(), base + 1000);
+    const size_t cap = pool.capacity();
+
+    // release every other one; the next acquires reuse those slots
+    for(size_t k=0;k<held.size();k+=2) held[k].reset();
+    if(pool.live() != base + 500) bad = report(bad, "%zu live after 500 releases, expected %zu", pool.live(), base + 500);
+    for(size_t k=0;k<held.size();k+=2) held[k] = pool.acquire(Order(5000 + (int)k, 0, 0, 2.0));
+    if(pool.capacity() != cap) bad = report(bad, "pool grew from %zu to %zu instead of reusing slots", cap, pool.capacity());
+    for(size_t k=0;k<held.size();k++){
+        int want = k % 2 ? (int)k : 5000 + (int)k;
+        if(!held[k] || held[k]->id != want) bad = report(bad, "slot %zu holds order %d, expected %d", k, held[k] ? held[k]->id : -1, want);
+    }
+
+    // a ref kept past the release goes stale, even once its slot holds another order
+    OrderRef old = held[0].ref();
+    if(pool.get(old) != &*held[0]) bad = report(bad, "live ref does not resolve to its order");
+    held[0] = pool.acquire(Order(7000, 0, 0, 2.0));
+    if(held[0].ref().slot == old.slot && held[0].ref().gen == old.gen) bad = report(bad, "reused slot kept its generation");
+    if(pool.get(old)) bad = report(bad, "stale ref still resolves to order %d", pool.get(old)->id);
+
+    // move-only hand-over: one owner at a time, released by the last
+    PooledOrder a = pool.acquire(Order(42, 1, 2, 3.0));
+    PooledOrder b = std::move(a);
+    if(a || !b || b->id != 42) bad = report(bad, "move did not hand the order over");
+    held.clear();
+    b.reset();
+    if(pool.live() != base) bad = report(bad, "%zu live after releasing everything, expected %zu", pool.live(), base);
+
+    // producers on several threads, each checking its own orders are never overwritten
+    std::atomic<int> corrupt{0};
+    std::vector<std::thread> threads;
+    unsigned seed = (unsigned)rng();
+    for(int t=0;t<4;t++){
+        threads.emplace_back([&, t]{
+            std::mt19937 r(seed + t);
+            std::vector<PooledOrder> mine;
+            for(int i=0;i<20000;i++){
+                mine.push_back(pool.acquire(Order(t * 100000 + i, t, i, 1.0)));
+                if(mine.size() > 64 || r() % 4 == 0){
+                    size_t k = r() % mine.size();
+                    if(mine[k]->pickup != t || mine[k]->id != t * 100000 + mine[k]->dropoff) corrupt++;
+                    mine.erase(mine.begin() + k);
+                }
+            }
+        });
+    }
+    for(auto &t: threads) t.join();
+    if(corrupt.load()) bad = report(bad, "%d orders changed while held by another thread", corrupt.load());
+    if(pool.live() != base) bad = report(bad, "%zu live after the threads finished, expected %zu", pool.live(), base);
+    return bad;
+}
+
+int main(int argc, char **argv){
+    std::string only, dir;
+    unsigned seed = 1;
+    for(int i=1;i<argc;i++){
+        std::string a = argv[i];
+        auto next = [&]{ return i+1 < argc ? std::string(argv[++i]) : std::string(); };
+        if(a == "--only") only = next();
+        else if(a == "--seed") seed = (unsigned)std::atoi(next().c_str());
+        else if(a == "--dir") dir = next();
+        else {
+            std::cerr << "usage: selfcheck [--only ch|live|batch|store|insertion|pool] [--seed S] [--dir DIR]\n";
+            return 2;
+        }
+    }
+    Logger::setLevel(LogLevel::ERROR); // the store check provokes journal warnings on purpose
+
+    std::vector<std::pair<std::string, std::function<int(std::mt19937&)>>> checks{
+        {"ch", checkCh},
+        {"live", checkLive},
+        {"batch", checkBatch},
+        {"store", [&](std::mt19937 &rng){ return checkStore(rng, dir); }},
+        {"insertion", checkInsertion},
+        {"pool", checkPool},
+    };
+    int failed = 0, ran = 0;
+    for(auto &c: checks){
+        if(!only.empty() && c.first != only) continue;
+        std::mt19937 rng(seed);
+        auto t0 = std::chrono::steady_clock::now();
+        int bad = c.second(rng);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::printf("%-10s %s (%.0f ms)\n", c.first.c_str(), bad ? "FAILED" : "ok", ms);
+        if(bad) std::printf("%-10s %d mismatches\n", "", bad);
+        failed += bad > 0;
+        ran++;
+    }
+    Logger::flush();
+    if(ran == 0){
+        std::cerr << "no check named " << only << "\n";
+        return 2;
+    }
+    return failed ? 1 : 0;
+}